@@ -8,6 +8,8 @@ CONFIG += c++11
 # Флаги компиляции из исходного Makefile
 QMAKE_CXXFLAGS += -O3 -pthread -mfpmath=sse -fstack-protector-all -g -W -Wall -Wextra -Wunused -Wcast-align -Werror -pedantic -pedantic-errors -Wfloat-equal -Wpointer-arith -Wformat-security -Wmissing-format-attribute -Wformat=1 -Wwrite-strings -Wcast-align -Wno-long-long -Woverloaded-virtual -Wnon-virtual-dtor -Wcast-qual -Wno-suggest-attribute=format
 
+# Профилирование фаз по потокам: qmake "DEFINES += APPROX_PROFILE"
+
 # Подключаем pthread
 LIBS += -lpthread
 
@@ -15,12 +17,29 @@ LIBS += -lpthread
 SOURCES += \
     gui_main.cpp \
     algorithm.cpp \
+    arena.cpp \
+    checkpoint.cpp \
+    history.cpp \
+    output.cpp \
+    perf.cpp \
+    profile.cpp \
+    trace.cpp \
     functions.cpp \
     solution.cpp \
     reduce_sum.cpp \
     residual.cpp \
+    sstep.cpp \
+    sweep.cpp \
+    steal.cpp \
+    tiling.cpp \
     window.cpp \
-    renderer.cpp
+    renderer.cpp \
+    raster.cpp \
+    pyramid.cpp \
+    samples.cpp \
+    batch_render.cpp \
+    replay.cpp \
+    history_plot.cpp
 
 # Заголовочные файлы
 HEADERS += \
@@ -29,8 +48,24 @@ HEADERS += \
     parallel_utils.h \
     function_types.h \
     common_types.h \
+    arena.h \
+    checkpoint.h \
+    history.h \
+    output.h \
+    perf.h \
+    profile.h \
+    trace.h \
+    sweep.h \
+    steal.h \
+    tiling.h \
     window.hpp \
-    renderer.hpp
+    renderer.hpp \
+    raster.h \
+    pyramid.h \
+    samples.h \
+    batch_render.hpp \
+    replay.hpp \
+    history_plot.hpp
 
 
 
@@ -1,27 +1,69 @@
 #include "all_includes.h"
 #include <sys/resource.h>
+#include <time.h>
+#include <climits>
 
 #define FUNC(I, J) do { ij2l(nx, ny, I, J, k); if (I_ij) { I_ij[m] = k; } m++; } \
                   while (0)
 
 #define F(I, J) (f(a + (I)*hx, c + (J)*hy))
 
-void matrix_mult_vector_msr(int n, double* A, int* I, double* x, double* y, int p, int k) {
-    int i, i1, i2, l, J; double s;
+// Вне памяти проходы по строкам потока идут окнами по PREFETCH_ROWS строк:
+// перед окном ядро получает подсказку на следующее (для обратного прохода --
+// предыдущее). Подсказка на всю полосу потока, которая сама больше памяти,
+// вытесняла бы её начало раньше, чем до него дойдёт проход.
+static void prefetch_vectors(int i1, int i2, const double* x, const double* y) {
+    if (!arena_out_of_core() || i1 >= i2) {
+        return;
+    }
+    arena_willneed(x + i1, (size_t)(i2 - i1) * sizeof(double));
+    arena_willneed(y + i1, (size_t)(i2 - i1) * sizeof(double));
+}
+
+// Строки i1..i2 матрицы и те же компоненты векторов x, y
+template <class index_t>
+static void prefetch_msr_rows(int i1, int i2, const double* A, const index_t* I, const double* x, const double* y) {
+    if (!arena_out_of_core() || i1 >= i2) {
+        return;
+    }
+    arena_willneed(A + i1, (size_t)(i2 - i1) * sizeof(double));
+    arena_willneed(I + i1, (size_t)(i2 - i1 + 1) * sizeof(index_t));
+    arena_willneed(A + I[i1], (size_t)(I[i2] - I[i1]) * sizeof(double));
+    arena_willneed(I + I[i1], (size_t)(I[i2] - I[i1]) * sizeof(index_t));
+    prefetch_vectors(i1, i2, x, y);
+}
+
+template <class index_t>
+void matrix_mult_vector_msr(int n, double* A, index_t* I, double* x, double* y, int p, int k) {
+    PROFILE_SCOPE(PHASE_MATVEC);
+    int i1, i2;
     thread_rows(n, p, k, i1, i2);
-    for (i = i1; i < i2; ++i) {
-        s = A[i] * x[i];
-        l = I[i+1] - I[i];
-        J = I[i];
-        for (int j = 0; j < l; ++j) {
-            s += A[J + j] * x[I[J + j]];
-        }
+    matrix_mult_vector_msr_rows(i1, i2, A, I, x, y);
+}
+
+template <class index_t>
+void matrix_mult_vector_msr_rows(int i1, int i2, double* A, index_t* I, double* x, double* y) {
+    int i, l; index_t J; double s;
+    prefetch_msr_rows(i1, std::min(i1 + PREFETCH_ROWS, i2), A, I, x, y);
+    for (int w1 = i1; w1 < i2; w1 += PREFETCH_ROWS) {
+        const int w2 = std::min(w1 + PREFETCH_ROWS, i2);
+        prefetch_msr_rows(w2, std::min(w2 + PREFETCH_ROWS, i2), A, I, x, y);
+        for (i = w1; i < w2; ++i) {
+            s = A[i] * x[i];
+            l = I[i+1] - I[i];
+            J = I[i];
+            for (int j = 0; j < l; ++j) {
+                s += A[J + j] * x[I[J + j]];
+            }
 
-        y[i] = s;
+            y[i] = s;
+        }
     }
 }
 
-void apply_preconditioner_msr_matrix(int n, double* A, int* I, double* v1, double* v2, int flag, int p, int k) {
+template <class index_t>
+void apply_preconditioner_msr_matrix(int n, double* A, index_t* I, double* v1, double* v2, int flag, int p, int k) {
+    PROFILE_SCOPE(PHASE_PRECOND);
     const double omega = 1.0; 
     
     if (flag == 0) {
@@ -33,16 +75,24 @@ void apply_preconditioner_msr_matrix(int n, double* A, int* I, double* v1, doubl
     reduce_sum<int>(p);
 }
 
-bool step(int n, double* A, int* I, double* x, double* r, double* u, double* v, double prec, int p, int k) {
+template <class index_t>
+bool step(int n, double* A, index_t* I, double* x, double* r, double* u, double* v, double prec, int p, int k,
+    History* history) {
     matrix_mult_vector_msr(n, A, I, v, u, p, k);
     
     const double residual_norm = scalar_product(n, r, r, p, k);
     const double direction_norm = scalar_product(n, u, u, p, k);
 
     if (residual_norm < prec || direction_norm < prec) {
+        if (history != nullptr && k == 0) {
+            history_record(history, residual_norm, 0);
+        }
         return true; // Достигнута сходимость
     }
     const double step_size = residual_norm / direction_norm;
+    if (history != nullptr && k == 0) {
+        history_record(history, residual_norm, step_size);
+    }
     
     mult_sub_vector(n, x, v, step_size, p, k);
     
@@ -51,13 +101,18 @@ bool step(int n, double* A, int* I, double* x, double* r, double* u, double* v,
     return false;
 }
 
-int minimal_errors_msr_matrix(int n, double* A, int* I, double* b, double* x,
-    double* r, double* u, double* v, double eps, int maxit, int p, int k) {
+template <class index_t>
+int minimal_errors_msr_matrix(int n, double* A, index_t* I, double* b, double* x,
+    double* r, double* u, double* v, double eps, int maxit, int p, int k, History* history,
+    Checkpoint* ckpt, int nx, int ny, int attempt, int iterations) {
     
     double convergence_threshold;
     int iteration_count;
     
     const double rhs_norm_squared = scalar_product(n, b, b, p, k);
+    if (history != nullptr && k == 0) {
+        history->rhs_norm = sqrt(rhs_norm_squared);
+    }
     
     convergence_threshold = rhs_norm_squared * eps * eps;
     
@@ -67,7 +122,7 @@ int minimal_errors_msr_matrix(int n, double* A, int* I, double* b, double* x,
     for (iteration_count = 0; iteration_count < maxit; ++iteration_count) {
         apply_preconditioner_msr_matrix(n, A, I, v, r, 0, p, k);
         
-        if (step(n, A, I, x, r, u, v, convergence_threshold, p, k)) {
+        if (step(n, A, I, x, r, u, v, convergence_threshold, p, k, history)) {
             break;
         }
         
@@ -76,9 +131,15 @@ int minimal_errors_msr_matrix(int n, double* A, int* I, double* b, double* x,
         
         apply_preconditioner_msr_matrix(n, A, I, v, u, 1, p, k);
         
-        if (step(n, A, I, x, r, u, v, convergence_threshold, p, k)) {
+        if (step(n, A, I, x, r, u, v, convergence_threshold, p, k, history)) {
             break;
         }
+        
+        // После полной итерации x и r согласованы. Снимок после последней
+        // итерации делает вызывающий уже как конец перезапуска
+        if (iteration_count + 1 < maxit) {
+            checkpoint_save(ckpt, nx, ny, x, r, attempt, iterations + iteration_count + 1, p, k);
+        }
     }
     
     if (iteration_count >= maxit) {
@@ -88,15 +149,27 @@ int minimal_errors_msr_matrix(int n, double* A, int* I, double* b, double* x,
     return iteration_count; // Количество итераций до сходимости
 }
 
-int minimal_errors_msr_matrix_full(int n, double* A, int* I, double* b, double* x, double* r, double* u, double* v, 
-    double eps, int maxit, int maxsteps, int p, int k) {
+template <class index_t>
+int minimal_errors_msr_matrix_full(int n, double* A, index_t* I, double* b, double* x, double* r, double* u, double* v, 
+    double eps, int maxit, int maxsteps, int p, int k, int nx, int ny, Checkpoint* ckpt, History* history) {
 
-    int current_attempt;
+    int current_attempt = 0;
     int convergence_status;
     int total_iterations = 0;
+
+    // Продолжение с контрольной точки: x уже загружен, счётчики берутся из снимка.
+    // Снимок изнутри перезапуска продолжается новым перезапуском с тем же номером
+    if (ckpt != nullptr) {
+        current_attempt = ckpt->resume_attempt;
+        total_iterations = ckpt->resume_iterations;
+    }
     
-    for (current_attempt = 0; current_attempt < maxsteps; ++current_attempt) {
-        convergence_status = minimal_errors_msr_matrix(n, A, I, b, x, r, u, v, eps, maxit, p, k);
+    for (; current_attempt < maxsteps; ++current_attempt) {
+        if (history != nullptr && k == 0) {
+            history->restart = current_attempt;
+        }
+        convergence_status = minimal_errors_msr_matrix(n, A, I, b, x, r, u, v, eps, maxit, p, k, history,
+                                                       ckpt, nx, ny, current_attempt, total_iterations);
         
         if (convergence_status >= 0) {
             total_iterations += convergence_status;
@@ -104,6 +177,7 @@ int minimal_errors_msr_matrix_full(int n, double* A, int* I, double* b, double*
         }
         
         total_iterations += maxit;
+        checkpoint_save(ckpt, nx, ny, x, r, current_attempt + 1, total_iterations, p, k);
     }
     
     if (current_attempt >= maxsteps) {
@@ -114,14 +188,26 @@ int minimal_errors_msr_matrix_full(int n, double* A, int* I, double* b, double*
 }
 
 void thread_rows(int n, int p, int k, int& i1, int& i2) {
-    i1 = n*k; i1 /= p; i2 = n*(k + 1); i2 /= p; 
+    const Tiling* t = get_tiling();
+    if (t != nullptr && t->p == p && n == (t->nx + 1) * (t->ny + 1)) {
+        i1 = t->offset[k]; i2 = t->offset[k + 1];
+        return;
+    }
+    // n*k считается в long long: при n ~ 10^9 произведение не помещается в int
+    i1 = (int)((long long)n * k / p); i2 = (int)((long long)n * (k + 1) / p);
 }
 
 double scalar_product(int n, double* x, double* y, int p, int k) {
+    PROFILE_SCOPE(PHASE_DOT);
     int i1, i2, i; double s = 0;
     thread_rows(n, p, k, i1, i2);
-    for (i = i1; i < i2; ++i) {
-        s += x[i] * y[i];
+    prefetch_vectors(i1, std::min(i1 + PREFETCH_ROWS, i2), x, y);
+    for (int w1 = i1; w1 < i2; w1 += PREFETCH_ROWS) {
+        const int w2 = std::min(w1 + PREFETCH_ROWS, i2);
+        prefetch_vectors(w2, std::min(w2 + PREFETCH_ROWS, i2), x, y);
+        for (i = w1; i < w2; ++i) {
+            s += x[i] * y[i];
+        }
     }
 
     s = reduce_sum_det(p, k, s);
@@ -129,46 +215,65 @@ double scalar_product(int n, double* x, double* y, int p, int k) {
 }
 
 void mult_sub_vector(int n, double* x, double* y, double tau, int p, int k) {
+    PROFILE_SCOPE(PHASE_AXPY);
     int i, i1, i2;
     thread_rows(n, p, k, i1, i2);
-    for (i = i1; i < i2; ++i) {
-        x[i] -= tau * y[i];
+    prefetch_vectors(i1, std::min(i1 + PREFETCH_ROWS, i2), x, y);
+    for (int w1 = i1; w1 < i2; w1 += PREFETCH_ROWS) {
+        const int w2 = std::min(w1 + PREFETCH_ROWS, i2);
+        prefetch_vectors(w2, std::min(w2 + PREFETCH_ROWS, i2), x, y);
+        for (i = w1; i < w2; ++i) {
+            x[i] -= tau * y[i];
+        }
     }
 
     reduce_sum<int>(p);
 }
 
-void ij2l(int nx, int, int i, int j, int& l) {
+void ij2l(int nx, int ny, int i, int j, int& l) {
+    if (tiling_renumbers(nx, ny)) {
+        l = tile_ij2l(i, j);
+        return;
+    }
     l = i + j * (int)(nx + 1);
 }
 
-void l2ij(int nx, int, int& i, int& j, int l) {
+void l2ij(int nx, int ny, int& i, int& j, int l) {
+    if (tiling_renumbers(nx, ny)) {
+        tile_l2ij(l, i, j);
+        return;
+    }
     j = l / (nx + 1);
     i = l - j * (nx + 1);
 }
 
-int get_len_msr(int nx, int ny) {
-    return (nx + 1)*(ny + 1)
-            + 6*(nx - 1)*(ny - 1)
-            + 4*(2*(nx-1) + 2*(ny-1))
+long long get_len_msr(int nx, int ny) {
+    return (long long)(nx + 1)*(ny + 1)
+            + 6LL*(nx - 1)*(ny - 1)
+            + 4LL*(2*(nx-1) + 2*(ny-1))
             + 2*3 + 2*2; 
 }
 
+// Число ненулевых (nx+1)*(ny+1)*7 превышает INT_MAX -- смещения в I нужны 64-битные
+bool msr_needs_64bit(int nx, int ny) {
+    return (long long)(nx + 1) * (ny + 1) * 7 > INT_MAX;
+}
+
+// Порядок соседей узла в строке MSR; на него опираются fill_A_ij и matrix_powers_msr
+const int msr_neighbors[6][2] = {
+    {1, 0},   // right
+    {0, -1},  // down
+    {-1, -1}, // down-left
+    {-1, 0},  // left
+    {0, 1},   // up
+    {1, 1}    // up-right
+};
+
 int get_off_diag(int nx, int ny, int i, int j, int* I_ij) {
-    struct Neighbor { int di, dj; };
-    const Neighbor neighbors[] = {
-        {1, 0},   // right
-        {0, -1},  // down
-        {-1, -1}, // down-left
-        {-1, 0},  // left
-        {0, 1},   // up
-        {1, 1}    // up-right
-    };
-    
     int count = 0;
     for (int idx = 0; idx < 6; ++idx) {
-        int ni = i + neighbors[idx].di;
-        int nj = j + neighbors[idx].dj;
+        int ni = i + msr_neighbors[idx][0];
+        int nj = j + msr_neighbors[idx][1];
         
         if (ni >= 0 && ni <= nx && nj >= 0 && nj <= ny) {
             if (I_ij != nullptr) {
@@ -183,8 +288,8 @@ int get_off_diag(int nx, int ny, int i, int j, int* I_ij) {
     return count;
 }
 
-int get_len_msr_off_diag(int nx, int ny) {
-    int total_offdiag = 0;
+long long get_len_msr_off_diag(int nx, int ny) {
+    long long total_offdiag = 0;
     
     for (int row = 0; row <= ny; ++row) {
         for (int col = 0; col <= nx; ++col) {
@@ -195,21 +300,22 @@ int get_len_msr_off_diag(int nx, int ny) {
     return total_offdiag;
 }
 
-int allocate_msr_matrix(int nx, int ny, double** p_A, int** p_I) {
+template <class index_t>
+int allocate_msr_matrix(int nx, int ny, double** p_A, index_t** p_I) {
     const int grid_size = (nx+1)*(ny+1);
     
-    int offdiag_elements = 0;
+    long long offdiag_elements = 0;
     for (int node = 0; node < grid_size; ++node) {
         int i, j;
         l2ij(nx, ny, i, j, node);
         offdiag_elements += get_off_diag(nx, ny, i, j, nullptr);
     }
     
-    int total_size = grid_size + offdiag_elements + 1;
+    long long total_size = grid_size + offdiag_elements + 1;
     
     try {
         *p_A = new double[total_size];
-        *p_I = new int[total_size];
+        *p_I = new index_t[total_size];
     } catch (std::bad_alloc&) {
         if (*p_A != nullptr) {
             delete[] *p_A;
@@ -221,12 +327,13 @@ int allocate_msr_matrix(int nx, int ny, double** p_A, int** p_I) {
     return 0; // success
 }
 
-void fill_I(int nx, int ny, int* I) {
+template <class index_t>
+void fill_I(int nx, int ny, index_t* I) {
     const int width = nx + 1;
     const int height = ny + 1;
     const int total_nodes = width * height;
     
-    int current_offset = total_nodes + 1;
+    index_t current_offset = total_nodes + 1;
     
     for (int node_idx = 0; node_idx < total_nodes; ++node_idx) {
         I[node_idx] = current_offset;
@@ -234,7 +341,12 @@ void fill_I(int nx, int ny, int* I) {
         int x, y;
         l2ij(nx, ny, x, y, node_idx);
         
-        int neighbor_count = get_off_diag(nx, ny, x, y, &I[current_offset]);
+        // Номера узлов всегда помещаются в int, широкими бывают только смещения
+        int neighbors[6];
+        int neighbor_count = get_off_diag(nx, ny, x, y, neighbors);
+        for (int m = 0; m < neighbor_count; ++m) {
+            I[current_offset + m] = neighbors[m];
+        }
         
         current_offset += neighbor_count;
     }
@@ -304,11 +416,13 @@ void fill_A_ij(int nx, int ny, double hx, double hy, int i, int j, double* A_dia
     // abort();
 }
 
-void fill_A(int nx, int ny, double hx, double hy, int* I, double* A, int p, int k) {
+template <class index_t>
+void fill_A(int nx, int ny, double hx, double hy, index_t* I, double* A, int p, int k) {
+    PROFILE_SCOPE(PHASE_FILL_A);
     const int totalNodes = (nx + 1) * (ny + 1);
     
-    const int startIdx = (totalNodes * k) / p;
-    const int endIdx = (totalNodes * (k + 1)) / p;
+    int startIdx, endIdx;
+    thread_rows(totalNodes, p, k, startIdx, endIdx);
 
     for (int nodeIndex = startIdx; nodeIndex < endIdx; ++nodeIndex) {
         int gridX, gridY;
@@ -329,23 +443,24 @@ void fill_A(int nx, int ny, double hx, double hy, int* I, double* A, int p, int
     reduce_sum<int>(p);
 }
 
-int check_symm(int nx, int ny, int* I, double* A, double eps, int p, int k) {
+template <class index_t>
+int check_symm(int nx, int ny, index_t* I, double* A, double eps, int p, int k) {
     const int GRID_SIZE = (nx+1)*(ny+1);
-    const int THREAD_START = (k * GRID_SIZE) / p;
-    const int THREAD_END = ((k + 1) * GRID_SIZE) / p;
+    int THREAD_START, THREAD_END;
+    thread_rows(GRID_SIZE, p, k, THREAD_START, THREAD_END);
     
     int symmetryErrors = 0;
     
     for (int rowIdx = THREAD_START; rowIdx < THREAD_END; ++rowIdx) {
-        const int elementsInRow = I[rowIdx + 1] - I[rowIdx];
-        const int rowOffset = I[rowIdx];
+        const int elementsInRow = (int)(I[rowIdx + 1] - I[rowIdx]);
+        const index_t rowOffset = I[rowIdx];
         
         for (int elemPos = 0; elemPos < elementsInRow; ++elemPos) {
             const double currentValue = A[rowOffset + elemPos];
-            const int colIdx = I[rowOffset + elemPos];
+            const int colIdx = (int)I[rowOffset + elemPos];
             
-            const int matchingRowOffset = I[colIdx];
-            const int matchingRowSize = I[colIdx + 1] - matchingRowOffset;
+            const index_t matchingRowOffset = I[colIdx];
+            const int matchingRowSize = (int)(I[colIdx + 1] - matchingRowOffset);
             
             int matchingPos = 0;
             bool foundMatch = false;
@@ -525,60 +640,84 @@ double F_IJ(int nx, int ny, double hx, double hy, double a, double c, int i, int
 }
 
 void fill_B(int nx, int ny, double hx, double hy, double a, double c, double* B, double (*f)(double, double), int p, int k) {
-    int l1, l2;
+    PROFILE_SCOPE(PHASE_FILL_B);
+    int l1, l2, chunk;
     int i, j;
     int N = (nx + 1) * (ny + 1);    
-    l1 = N * k; l1 /= p;
-    l2 = N * (k + 1); l2 /= p;
+    StealLoop loop;
+    steal_begin(&loop, node_work::assembly, N, p, k);
 
-    for (int l = l1; l < l2; ++l) {
-        l2ij(nx, ny, i, j, l);
-        B[l] = F_IJ(nx, ny, hx, hy, a, c, i, j, f);
+    while (steal_next(&loop, l1, l2, chunk)) {
+        for (int l = l1; l < l2; ++l) {
+            l2ij(nx, ny, i, j, l);
+            B[l] = F_IJ(nx, ny, hx, hy, a, c, i, j, f);
+        }
     }
 
     reduce_sum<int>(p);
 }
 
-void solve_rsystem(int n, int* I, double* U, double* b, double* x, double w, int p, int k) {
+template <class index_t>
+void solve_rsystem(int n, index_t* I, double* U, double* b, double* x, double w, int p, int k) {
     int start_idx, end_idx;
     thread_rows(n, p, k, start_idx, end_idx);
+    solve_rsystem_rows(start_idx, end_idx, I, U, b, x, w);
+}
 
-    for (int current = end_idx - 1; current >= start_idx; --current) {
-        const int num_elements = I[current + 1] - I[current];
-        
-        double sum_known = 0.0;
-        const int offset = I[current];
-        
-        for (int elem_idx = 0; elem_idx < num_elements; ++elem_idx) {
-            const int col_idx = I[offset + elem_idx];
-            if (col_idx > current && col_idx >= start_idx && col_idx < end_idx) {
-                sum_known += x[col_idx] * U[offset + elem_idx];
+template <class index_t>
+void solve_rsystem_rows(int start_idx, int end_idx, index_t* I, double* U, double* b, double* x, double w) {
+    // Проход от конца полосы к началу, окна упреждающего чтения -- тоже
+    prefetch_msr_rows(std::max(end_idx - PREFETCH_ROWS, start_idx), end_idx, U, I, b, x);
+    for (int w2 = end_idx; w2 > start_idx; w2 -= PREFETCH_ROWS) {
+        const int w1 = std::max(w2 - PREFETCH_ROWS, start_idx);
+        prefetch_msr_rows(std::max(w1 - PREFETCH_ROWS, start_idx), w1, U, I, b, x);
+        for (int current = w2 - 1; current >= w1; --current) {
+            const int num_elements = (int)(I[current + 1] - I[current]);
+            
+            double sum_known = 0.0;
+            const index_t offset = I[current];
+            
+            for (int elem_idx = 0; elem_idx < num_elements; ++elem_idx) {
+                const int col_idx = (int)I[offset + elem_idx];
+                if (col_idx > current && col_idx >= start_idx && col_idx < end_idx) {
+                    sum_known += x[col_idx] * U[offset + elem_idx];
+                }
             }
+            
+            x[current] = w * (b[current] - sum_known) / U[current];
         }
-        
-        x[current] = w * (b[current] - sum_known) / U[current];
     }
 }
 
-void solve_lsystem(int n, int* I, double* U, double* b, double* x, double w, int p, int k) {
+template <class index_t>
+void solve_lsystem(int n, index_t* I, double* U, double* b, double* x, double w, int p, int k) {
     int range_begin, range_end;
     thread_rows(n, p, k, range_begin, range_end);
-    
-    for (int row = range_begin; row < range_end; ++row) {
-        double accumulated_effect = 0.0;
-        
-        const int row_start = I[row];
-        const int element_count = I[row + 1] - row_start;
-        
-        for (int pos = 0; pos < element_count; ++pos) {
-            const int col = I[row_start + pos];
+    solve_lsystem_rows(range_begin, range_end, I, U, b, x, w);
+}
+
+template <class index_t>
+void solve_lsystem_rows(int range_begin, int range_end, index_t* I, double* U, double* b, double* x, double w) {
+    prefetch_msr_rows(range_begin, std::min(range_begin + PREFETCH_ROWS, range_end), U, I, b, x);
+    for (int w1 = range_begin; w1 < range_end; w1 += PREFETCH_ROWS) {
+        const int w2 = std::min(w1 + PREFETCH_ROWS, range_end);
+        prefetch_msr_rows(w2, std::min(w2 + PREFETCH_ROWS, range_end), U, I, b, x);
+        for (int row = w1; row < w2; ++row) {
+            double accumulated_effect = 0.0;
+            
+            const index_t row_start = I[row];
+            const int element_count = (int)(I[row + 1] - row_start);
             
-            if (col < row && col >= range_begin && col < range_end) {
-                accumulated_effect += x[col] * U[row_start + pos];
+            for (int pos = 0; pos < element_count; ++pos) {
+                const int col = (int)I[row_start + pos];
+                
+                if (col < row && col >= range_begin && col < range_end) {
+                    accumulated_effect += x[col] * U[row_start + pos];
+                }
             }
+            
+            x[row] = w * (b[row] - accumulated_effect) / U[row];
         }
-        
-        x[row] = w * (b[row] - accumulated_effect) / U[row];
     }
 }
 
@@ -587,3 +726,31 @@ double get_cpu_time() {
     getrusage(RUSAGE_THREAD, &buf);
     return buf.ru_utime.tv_sec + buf.ru_utime.tv_usec * 1e-6;
 }
+
+double wall_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Ядра MSR собираются для 32-битных и 64-битных индексов I
+#define INSTANTIATE_MSR(index_t) \
+    template void matrix_mult_vector_msr(int, double*, index_t*, double*, double*, int, int); \
+    template void matrix_mult_vector_msr_rows(int, int, double*, index_t*, double*, double*); \
+    template void apply_preconditioner_msr_matrix(int, double*, index_t*, double*, double*, int, int, int); \
+    template bool step(int, double*, index_t*, double*, double*, double*, double*, double, int, int, History*); \
+    template int minimal_errors_msr_matrix(int, double*, index_t*, double*, double*, \
+        double*, double*, double*, double, int, int, int, History*, Checkpoint*, int, int, int, int); \
+    template int minimal_errors_msr_matrix_full(int, double*, index_t*, double*, double*, \
+        double*, double*, double*, double, int, int, int, int, int, int, Checkpoint*, History*); \
+    template int allocate_msr_matrix(int, int, double**, index_t**); \
+    template void fill_I(int, int, index_t*); \
+    template void fill_A(int, int, double, double, index_t*, double*, int, int); \
+    template int check_symm(int, int, index_t*, double*, double, int, int); \
+    template void solve_rsystem(int, index_t*, double*, double*, double*, double, int, int); \
+    template void solve_lsystem(int, index_t*, double*, double*, double*, double, int, int); \
+    template void solve_rsystem_rows(int, int, index_t*, double*, double*, double*, double); \
+    template void solve_lsystem_rows(int, int, index_t*, double*, double*, double*, double);
+
+INSTANTIATE_MSR(int)
+INSTANTIATE_MSR(long long)
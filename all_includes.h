@@ -5,5 +5,12 @@
 #include "parallel_utils.h"
 #include "function_types.h"
 #include "common_types.h"
+#include "tiling.h"
+#include "steal.h"
+#include "arena.h"
+#include "checkpoint.h"
+#include "output.h"
+#include "trace.h"
+#include "history.h"
 
 #endif // ALL_INCLUDES_H 
\ No newline at end of file
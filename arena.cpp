@@ -0,0 +1,194 @@
+#include "all_includes.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <limits.h>
+#include <stdint.h>
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+// Арена на файле, если она есть; по ней включаются подсказки arena_willneed
+static const Arena* out_of_core = nullptr;
+
+// Участок округляется до 64 байт и дополняется ещё одной строкой кэша, чтобы
+// векторы одинаковой длины не начинались с одинакового смещения по модулю 4К
+size_t arena_region_size(size_t bytes) {
+    return (bytes + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN + ARENA_ALIGN;
+}
+
+int arena_reserve(Arena* arena, size_t bytes) {
+    arena_reset(arena);
+    if (bytes <= arena->capacity && arena->pages != arena_pages::file) {
+        return 0;
+    }
+
+    size_t peak = arena->peak;
+    arena_release(arena);
+    arena->peak = peak;
+
+    size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    arena->pages = arena_pages::hugetlb;
+
+    if (base == MAP_FAILED) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return -1;
+        }
+        arena->pages = madvise(base, size, MADV_HUGEPAGE) == 0
+                     ? arena_pages::transparent_huge : arena_pages::normal;
+    }
+
+    arena->base = (char*)base;
+    arena->capacity = size;
+    arena->maps++;
+    return 0;
+}
+
+// Внешняя память: арена отображается на файл в каталоге dir, удаляемый сразу
+// после создания. Ядро само вытесняет страницы на диск, поэтому A, I и векторы
+// могут превышать объём оперативной памяти; проходы по строкам потока
+// непрерывны (плитки), а MADV_SEQUENTIAL включает агрессивное упреждающее чтение.
+int arena_reserve_file(Arena* arena, size_t bytes, const char* dir) {
+    arena_reset(arena);
+    if (bytes <= arena->capacity && arena->pages == arena_pages::file) {
+        return 0;
+    }
+
+    size_t peak = arena->peak;
+    arena_release(arena);
+    arena->peak = peak;
+
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/approx2d-XXXXXX", dir) >= (int)sizeof(path)) {
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+
+    size_t size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    arena->base = (char*)base;
+    arena->capacity = size;
+    arena->fd = fd;
+    arena->pages = arena_pages::file;
+    arena->maps++;
+    out_of_core = arena;
+    return 0;
+}
+
+void* arena_alloc(Arena* arena, size_t bytes) {
+    size_t size = arena_region_size(bytes);
+    if (arena->base == nullptr || arena->used + size > arena->capacity) {
+        return nullptr;
+    }
+
+    void* ptr = arena->base + arena->used;
+    arena->used += size;
+    arena->peak = std::max(arena->peak, arena->used);
+    arena->regions++;
+    return ptr;
+}
+
+void arena_reset(Arena* arena) {
+    arena->used = 0;
+    arena->regions = 0;
+}
+
+void arena_release(Arena* arena) {
+    if (arena->base != nullptr) {
+        munmap(arena->base, arena->capacity);
+    }
+    if (arena->fd >= 0) {
+        close(arena->fd);
+    }
+    if (out_of_core == arena) {
+        out_of_core = nullptr;
+    }
+    arena->base = nullptr;
+    arena->fd = -1;
+    arena->capacity = 0;
+    arena->used = 0;
+    arena->regions = 0;
+}
+
+void arena_report(const Arena* arena, FILE* out) {
+    const char* pages = "normal";
+    if (arena->pages == arena_pages::transparent_huge) {
+        pages = "transparent huge (MADV_HUGEPAGE)";
+    } else if (arena->pages == arena_pages::hugetlb) {
+        pages = "hugetlbfs (MAP_HUGETLB)";
+    } else if (arena->pages == arena_pages::file) {
+        pages = "file (out of core)";
+    }
+
+    fprintf(out,
+        "Arena: capacity = %.2f MB used = %.2f MB peak = %.2f MB regions = %d maps = %d pages = %s\n",
+        arena->capacity / 1048576.0, arena->used / 1048576.0, arena->peak / 1048576.0,
+        arena->regions, arena->maps, pages);
+}
+
+bool arena_out_of_core() {
+    return out_of_core != nullptr;
+}
+
+// Подсказка ядру начать чтение участка с диска до прохода по нему;
+// для арены в оперативной памяти ничего не делает
+void arena_willneed(const void* ptr, size_t bytes) {
+    if (out_of_core == nullptr || bytes == 0) {
+        return;
+    }
+    static const uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t)ptr & ~(page - 1);
+    uintptr_t end = (uintptr_t)ptr + bytes;
+    madvise((void*)begin, end - begin, MADV_WILLNEED);
+}
+
+size_t solver_arena_size(int nx, int ny, int nvectors) {
+    size_t n = (size_t)(nx + 1) * (ny + 1);
+    size_t len = (size_t)get_len_msr(nx, ny) + 1;
+    size_t index_size = msr_needs_64bit(nx, ny) ? sizeof(long long) : sizeof(int);
+    return arena_region_size(len * sizeof(double)) + arena_region_size(len * index_size)
+         + nvectors * arena_region_size(n * sizeof(double));
+}
+
+// Матрица MSR и nvectors векторов длины (nx+1)*(ny+1) из одной арены;
+// арена должна быть зарезервирована не меньше чем на solver_arena_size()
+template <class index_t>
+int allocate_solver_buffers(Arena* arena, int nx, int ny, int nvectors,
+                            double** p_A, index_t** p_I, double** vectors) {
+    size_t n = (size_t)(nx + 1) * (ny + 1);
+    size_t len = (size_t)get_len_msr(nx, ny) + 1;
+
+    *p_A = (double*)arena_alloc(arena, len * sizeof(double));
+    *p_I = (index_t*)arena_alloc(arena, len * sizeof(index_t));
+    if (*p_A == nullptr || *p_I == nullptr) {
+        return 1;
+    }
+
+    for (int m = 0; m < nvectors; ++m) {
+        vectors[m] = (double*)arena_alloc(arena, n * sizeof(double));
+        if (vectors[m] == nullptr) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+template int allocate_solver_buffers(Arena*, int, int, int, double**, int**, double**);
+template int allocate_solver_buffers(Arena*, int, int, int, double**, long long**, double**);
@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define ARENA_ALIGN 64
+
+enum class arena_pages {
+    normal,
+    transparent_huge,   // madvise(MADV_HUGEPAGE)
+    hugetlb,            // mmap(MAP_HUGETLB), явные страницы hugetlbfs
+    file                // MAP_SHARED над файлом на диске, решение вне оперативной памяти
+};
+
+// Одна область mmap, из которой выдаются выровненные по 64 байта участки для
+// матрицы и векторов решателя. Отображение переиспользуется между запусками
+// и пересоздаётся только при росте требуемого объёма.
+struct Arena {
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t peak = 0;
+    int regions = 0;
+    int maps = 0;
+    arena_pages pages = arena_pages::normal;
+    int fd = -1;        // Файл внешней памяти, -1 для анонимного отображения
+};
+
+size_t arena_region_size(size_t bytes);
+int arena_reserve(Arena* arena, size_t bytes);
+int arena_reserve_file(Arena* arena, size_t bytes, const char* dir);
+void* arena_alloc(Arena* arena, size_t bytes);
+void arena_reset(Arena* arena);
+void arena_release(Arena* arena);
+void arena_report(const Arena* arena, FILE* out);
+
+bool arena_out_of_core();
+void arena_willneed(const void* ptr, size_t bytes);
+
+size_t solver_arena_size(int nx, int ny, int nvectors);
+template <class index_t>
+int allocate_solver_buffers(Arena* arena, int nx, int ny, int nvectors,
+                            double** p_A, index_t** p_I, double** vectors);
+
+#endif // ARENA_H
@@ -0,0 +1,397 @@
+#include "batch_render.hpp"
+#include "window.hpp"
+#include "samples.h"
+#include <QColor>
+#include <QString>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <sys/sysinfo.h>
+
+static const char* const mode_names[3] = {"function", "approximation", "residual"};
+
+static void* writer_loop(void* ptr) {
+    RenderWriter* writer = (RenderWriter*)ptr;
+
+    pthread_mutex_lock(&writer->mutex);
+    for (;;) {
+        while (writer->queue.empty() && !writer->stop) {
+            pthread_cond_wait(&writer->ready, &writer->mutex);
+        }
+        if (writer->queue.empty()) {
+            break;
+        }
+
+        RenderOutput output = writer->queue.back();
+        writer->queue.pop_back();
+        pthread_cond_signal(&writer->space);
+        pthread_mutex_unlock(&writer->mutex);
+
+        // Кодирование и запись -- без мьютекса, параллельно с отрисовкой
+        const bool ok = output.image.save(QString::fromStdString(output.path), writer->format);
+        if (!ok) {
+            fprintf(stderr, "Error: Cannot write %s.\n", output.path.c_str());
+        }
+
+        pthread_mutex_lock(&writer->mutex);
+        if (ok) {
+            writer->written++;
+        } else {
+            writer->failed++;
+        }
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    return nullptr;
+}
+
+int render_writer_init(RenderWriter* writer, int size, size_t capacity, const char* format) {
+    writer->size = 0;
+    writer->threads = new pthread_t[size];
+    writer->capacity = std::max(capacity, (size_t)1);
+    writer->format = format;
+    writer->written = 0;
+    writer->failed = 0;
+    writer->stop = false;
+    pthread_mutex_init(&writer->mutex, nullptr);
+    pthread_cond_init(&writer->ready, nullptr);
+    pthread_cond_init(&writer->space, nullptr);
+
+    for (int k = 0; k < size; ++k) {
+        if (pthread_create(&writer->threads[k], nullptr, &writer_loop, writer) != 0) {
+            return writer->size > 0 ? 0 : -1;
+        }
+        writer->size++;
+    }
+    return 0;
+}
+
+// QImage разделяет пиксели при копировании, поэтому изображение в очереди не копируется
+void render_writer_push(RenderWriter* writer, const QImage& image, const std::string& path) {
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->queue.size() >= writer->capacity) {
+        pthread_cond_wait(&writer->space, &writer->mutex);
+    }
+    RenderOutput output;
+    output.image = image;
+    output.path = path;
+    writer->queue.push_back(output);
+    pthread_cond_signal(&writer->ready);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+// Дожидается записи всей очереди; возвращает число незаписанных изображений
+int render_writer_finish(RenderWriter* writer) {
+    pthread_mutex_lock(&writer->mutex);
+    writer->stop = true;
+    pthread_cond_broadcast(&writer->ready);
+    pthread_mutex_unlock(&writer->mutex);
+
+    for (int k = 0; k < writer->size; ++k) {
+        pthread_join(writer->threads[k], nullptr);
+    }
+
+    pthread_cond_destroy(&writer->space);
+    pthread_cond_destroy(&writer->ready);
+    pthread_mutex_destroy(&writer->mutex);
+    delete[] writer->threads;
+    writer->threads = nullptr;
+    return writer->failed;
+}
+
+// Строки "файл_решения [префикс]", # -- комментарий. Без префикса имена
+// изображений строятся из имени файла без расширения, в out_dir, если он задан
+int read_render_jobs(const char* path, const char* out_dir, std::vector<RenderJob>* jobs) {
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    char line[4096];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        line_no++;
+        const char* s = line + strspn(line, " \t");
+        if (*s == '#' || *s == '\n' || *s == '\0') {
+            continue;
+        }
+
+        char input[2048];
+        char prefix[2048];
+        int fields = sscanf(s, "%2047s %2047s", input, prefix);
+        if (fields < 1) {
+            fclose(fp);
+            return line_no;
+        }
+
+        RenderJob job;
+        job.input = input;
+        if (fields == 2) {
+            job.prefix = prefix;
+        } else {
+            std::string name = job.input;
+            if (out_dir != nullptr) {
+                size_t slash = name.find_last_of('/');
+                name = std::string(out_dir) + "/" + (slash == std::string::npos ? name : name.substr(slash + 1));
+            }
+            size_t dot = name.find_last_of('.');
+            size_t slash = name.find_last_of('/');
+            if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+                name.erase(dot);
+            }
+            job.prefix = name;
+        }
+        jobs->push_back(job);
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+// Изображение режима mode по всей области, как окно при исходном масштабе:
+// значения в узлах решётки mx x my, шкала цветов по всей сетке
+void render_solution(const OutputFile* file, what_to_paint mode, const RenderOptions* options,
+    const ColorLut* standard, const ColorLut* residual, QImage* image) {
+    const OutputHeader* h = file->header;
+    const int dataWidth = h->nx + 1;
+    const int dataHeight = h->ny + 1;
+    const int mx = options->mx;
+    const int my = options->my;
+
+    Functions func;
+    func.select_f(h->k);
+
+    // Потоки заняты изображениями целиком, пирамиды строятся в вызывающем
+    StealPool serial;
+    steal_pool_init(&serial, 1);
+    Pyramid pyramid;
+
+    std::vector<double> values((size_t)mx * my);
+    const ColorLut* lut = standard;
+    FieldRange range;
+
+    switch (mode) {
+        case what_to_paint::function: {
+            FunctionSamples samples = {values.data(), func.f, h->a, h->c, h->b - h->a, h->d - h->c, mx, my};
+            sample_function(&samples, 0, my);
+            function_range(*std::min_element(values.begin(), values.end()),
+                           *std::max_element(values.begin(), values.end()), values[0], &range);
+            break;
+        }
+        case what_to_paint::approximation: {
+            pyramid_build(&pyramid, file->x, dataWidth, dataHeight, &serial);
+            int level = sample_level(&pyramid, dataWidth - 1, dataHeight - 1, mx - 1, my - 1);
+            DataSamples samples = {values.data(), &pyramid, level, dataWidth, dataHeight,
+                                   h->a, h->b, h->c, h->d, h->a, h->c, h->b - h->a, h->d - h->c, mx, my};
+            sample_data(&samples, 0, my);
+            data_range(&pyramid, &range);
+            break;
+        }
+        case what_to_paint::residual: {
+            lut = residual;
+            const int cellsX = h->nx;
+            const int cellsY = h->ny;
+            std::vector<double> cells((size_t)cellsX * cellsY);
+
+            // Погрешности в треугольниках из файла, иначе -- по x и f
+            if (file->triangle_errors != nullptr) {
+                for (size_t c = 0; c < cells.size(); ++c) {
+                    cells[c] = std::max(file->triangle_errors[2 * c], file->triangle_errors[2 * c + 1]);
+                }
+            } else {
+                ResidualSamples samples = {cells.data(), file->x, func.f, dataWidth, dataHeight,
+                                           h->a, h->c, (h->b - h->a) / cellsX, (h->d - h->c) / cellsY};
+                sample_residual(&samples, 0, cellsY);
+            }
+            pyramid_build(&pyramid, cells.data(), cellsX, cellsY, &serial);
+
+            int level = sample_level(&pyramid, cellsX, cellsY, mx - 1, my - 1);
+            CellSamples samples = {values.data(), &pyramid, level, cellsX, cellsY,
+                                   h->a, h->c, (h->b - h->a) / cellsX, (h->d - h->c) / cellsY,
+                                   h->a, h->c, h->b - h->a, h->d - h->c, mx, my};
+            sample_cells(&samples, 0, my);
+            residual_range(pyramid.level[pyramid.levels - 1].max[0], &range);
+            break;
+        }
+    }
+
+    constant_fill(&range, values.data(), mx, my, h->a, h->c, h->b - h->a, h->d - h->c, h->a, h->b, h->c, h->d);
+
+    *image = QImage(options->width, options->height, QImage::Format_RGB32);
+    std::vector<int> columns(options->width);
+    RasterGrid grid = {values.data(), mx, my, range.min, range.max, h->a, h->c, h->b - h->a, h->d - h->c};
+    std::vector<unsigned int> colors(raster_color_count(&grid));
+
+    Raster raster;
+    raster.grid = &grid;
+    raster.lut = lut;
+    raster.pixels = reinterpret_cast<unsigned int*>(image->bits());
+    raster.stride = image->bytesPerLine() / 4;
+    raster.width = options->width;
+    raster.height = options->height;
+    raster.left = h->a;
+    raster.top = h->c;
+    raster.view_width = h->b - h->a;
+    raster.view_height = h->d - h->c;
+    raster.background = QColor("#F0F0F0").rgb();
+    raster.columns = columns.data();
+    raster.colors = colors.data();
+    raster_columns(&raster);
+    raster_colors(&raster, 0, my - 1);
+    raster_rows(&raster, 0, raster.height);
+
+    pyramid_free(&pyramid);
+    steal_pool_free(&serial);
+}
+
+struct BatchState {
+    const std::vector<RenderJob>* jobs;
+    const OutputFile* files;
+    const RenderOptions* options;
+    ColorLut standard;
+    ColorLut residual;
+    RenderWriter writer;
+    std::atomic<int> next;
+};
+
+// Задача t -- решение t / 3 в режиме t % 3
+static void* render_loop(void* ptr) {
+    BatchState* state = (BatchState*)ptr;
+    const int total = 3 * (int)state->jobs->size();
+
+    for (int t = state->next++; t < total; t = state->next++) {
+        const RenderJob& job = (*state->jobs)[t / 3];
+        const what_to_paint mode = (what_to_paint)(t % 3);
+
+        QImage image;
+        render_solution(&state->files[t / 3], mode, state->options, &state->standard, &state->residual, &image);
+        render_writer_push(&state->writer, image,
+            job.prefix + "_" + mode_names[t % 3] + "." + state->options->format);
+    }
+
+    return nullptr;
+}
+
+int run_render_batch(const std::vector<RenderJob>& jobs, const RenderOptions* options) {
+    const int count = (int)jobs.size();
+    OutputFile* files = new OutputFile[count + 1];
+    int opened = 0;
+
+    // Все файлы открываются заранее: ошибка в списке видна до начала работы
+    for (; opened < count; ++opened) {
+        int res = output_open(jobs[opened].input.c_str(), &files[opened]);
+        if (res == -2) {
+            fprintf(stderr, "Error: Invalid or truncated solution file %s.\n", jobs[opened].input.c_str());
+            break;
+        }
+        if (res != 0) {
+            fprintf(stderr, "Error: Cannot read solution file %s.\n", jobs[opened].input.c_str());
+            break;
+        }
+    }
+    if (opened < count) {
+        for (int i = 0; i < opened; ++i) {
+            output_close(&files[i]);
+        }
+        delete[] files;
+        return 1;
+    }
+
+    BatchState* state = new BatchState;
+    state->jobs = &jobs;
+    state->files = files;
+    state->options = options;
+    state->next = 0;
+    Renderer::colorTables(&state->standard, &state->residual);
+
+    const double t = wall_time();
+    const int threads = options->threads;
+    int status = render_writer_init(&state->writer, threads, 2 * (size_t)threads, options->format);
+    pthread_t* workers = new pthread_t[threads];
+    int started = 1;
+
+    if (status == 0) {
+        for (; started < threads; ++started) {
+            if (pthread_create(&workers[started], nullptr, &render_loop, state) != 0) {
+                break;
+            }
+        }
+        render_loop(state);
+        for (int k = 1; k < started; ++k) {
+            pthread_join(workers[k], nullptr);
+        }
+    }
+    const int failed = render_writer_finish(&state->writer);
+
+    if (status == 0) {
+        printf("Rendered %d images from %d solutions in %.2f s (%d render threads)\n",
+               state->writer.written, count, wall_time() - t, started);
+    } else {
+        fprintf(stderr, "Error: Failed to start writer threads.\n");
+    }
+
+    for (int i = 0; i < count; ++i) {
+        output_close(&files[i]);
+    }
+    delete[] workers;
+    delete state;
+    delete[] files;
+    return status != 0 || failed > 0 ? 1 : 0;
+}
+
+int render_batch_main(int argc, char* argv[]) {
+    const char* list_path = argv[2];
+    const char* out_dir = nullptr;
+    RenderOptions options;
+    options.width = 512;
+    options.height = 512;
+    options.mx = 100;
+    options.my = 100;
+    options.format = "png";
+    options.threads = get_nprocs();
+
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--render-dir") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (strcmp(argv[i], "--render-size") == 0 && i + 2 < argc) {
+            options.width = atoi(argv[++i]);
+            options.height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--render-detail") == 0 && i + 2 < argc) {
+            options.mx = atoi(argv[++i]);
+            options.my = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--render-threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--render-format") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "png") == 0 || strcmp(argv[i], "ppm") == 0) {
+                options.format = argv[i];
+            } else {
+                fprintf(stderr, "Error: Unknown image format %s.\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown render option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (options.width < 1 || options.height < 1 || options.mx < 5 || options.my < 5 || options.threads < 1) {
+        fprintf(stderr, "Error: Image size and threads must be positive, mx and my at least 5.\n");
+        return 1;
+    }
+
+    std::vector<RenderJob> jobs;
+    int res = read_render_jobs(list_path, out_dir, &jobs);
+    if (res < 0) {
+        fprintf(stderr, "Error: Cannot open render list %s.\n", list_path);
+        return 1;
+    }
+    if (res > 0) {
+        fprintf(stderr, "Error: Invalid line at %s:%d.\n", list_path, res);
+        return 1;
+    }
+
+    return run_render_batch(jobs, &options);
+}
@@ -0,0 +1,65 @@
+#ifndef BATCH_RENDER_HPP
+#define BATCH_RENDER_HPP
+
+#include <QImage>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "output.h"
+#include "raster.h"
+
+enum class what_to_paint;
+
+// Пакетная отрисовка решений, записанных a.out --output, в файлы PNG или PPM
+// без окна и без дисплея: те же выборки, пирамиды и таблицы цветов, что у
+// Renderer, решётка mx x my покрывает всю область. Задача -- одно изображение
+// (решение и режим); рисующие потоки берут задачи по очереди, а готовые
+// изображения кодируют и записывают отдельные потоки, пока рисуются следующие.
+
+// Строка списка: файл решения и необязательный префикс имён изображений
+struct RenderJob {
+    std::string input;
+    std::string prefix;
+};
+
+struct RenderOptions {
+    int width;              // Размер изображения в пикселях
+    int height;
+    int mx;                 // Детализация визуализации, как у окна
+    int my;
+    const char* format;     // "png" или "ppm"
+    int threads;
+};
+
+struct RenderOutput {
+    QImage image;
+    std::string path;
+};
+
+// Очередь изображений на запись; при capacity готовых изображений рисующие
+// потоки ждут, чтобы память не росла быстрее записи
+struct RenderWriter {
+    int size;
+    pthread_t* threads;
+    std::vector<RenderOutput> queue;
+    size_t capacity;
+    const char* format;
+    int written;
+    int failed;
+    bool stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+    pthread_cond_t space;
+};
+
+int render_writer_init(RenderWriter* writer, int size, size_t capacity, const char* format);
+void render_writer_push(RenderWriter* writer, const QImage& image, const std::string& path);
+int render_writer_finish(RenderWriter* writer);
+
+int read_render_jobs(const char* path, const char* out_dir, std::vector<RenderJob>* jobs);
+void render_solution(const OutputFile* file, what_to_paint mode, const RenderOptions* options,
+    const ColorLut* standard, const ColorLut* residual, QImage* image);
+int run_render_batch(const std::vector<RenderJob>& jobs, const RenderOptions* options);
+int render_batch_main(int argc, char* argv[]);
+
+#endif // BATCH_RENDER_HPP
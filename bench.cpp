@@ -0,0 +1,468 @@
+#include "all_includes.h"
+#include "perf.h"
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Микробенчмарк ядер решателя. Для каждого размера сетки и числа потоков
+// печатает время одного вызова, достигнутую пропускную способность и GFLOP/s,
+// а также долю от измеренной пропускной способности STREAM triad и потолок
+// по памяти AI * STREAM (roofline). Байты и флопы считаются по минимальному
+// трафику ядра: каждый массив читается или пишется один раз.
+// С --perf каждый поток считает аппаратные события своей группой
+// perf_event_open, и для ядер печатается вторая таблица: IPC, обращения и
+// промахи LLC и промахи ветвлений на вызов, сумма по потокам.
+
+enum bench_kernel {
+    BENCH_MATVEC,
+    BENCH_DOT,
+    BENCH_AXPY,
+    BENCH_BARRIER,
+    BENCH_REDUCE_DET,
+    BENCH_PRECOND_R,
+    BENCH_PRECOND_L,
+    BENCH_FILL_A,
+    BENCH_FILL_B,
+    BENCH_R1,
+    BENCH_R2,
+    BENCH_R3,
+    BENCH_R4,
+    BENCH_COUNT
+};
+
+static const char* bench_names[BENCH_COUNT] = {
+    "matvec", "scalar_product", "mult_sub_vector", "reduce_sum", "reduce_sum_det",
+    "precond_rsystem", "precond_lsystem", "fill_A", "fill_B", "r1", "r2", "r3", "r4"
+};
+
+struct BenchArgs {
+    Args solver;
+    double target;      // Желаемое время замера одного ядра, с
+    double* seconds;    // BENCH_COUNT значений, пишет поток 0
+    double* events;     // p * BENCH_COUNT * PERF_COUNT событий на вызов или nullptr
+};
+
+static void run_kernel(int kernel, Args* a, double hx, double hy) {
+    const int n = (a->nx + 1) * (a->ny + 1);
+    const int p = a->p, k = a->k;
+    volatile double sink = 0;
+
+    switch (kernel) {
+        case BENCH_MATVEC:
+            matrix_mult_vector_msr(n, a->A, a->I, a->x, a->u, p, k);
+            reduce_sum<int>(p);
+            break;
+        case BENCH_DOT:
+            sink = scalar_product(n, a->x, a->u, p, k);
+            break;
+        case BENCH_AXPY:
+            mult_sub_vector(n, a->v, a->u, 1e-3, p, k);
+            break;
+        case BENCH_BARRIER:
+            reduce_sum<int>(p);
+            break;
+        case BENCH_REDUCE_DET:
+            sink = reduce_sum_det(p, k, 1.0);
+            break;
+        case BENCH_PRECOND_R:
+            apply_preconditioner_msr_matrix(n, a->A, a->I, a->v, a->r, 0, p, k);
+            break;
+        case BENCH_PRECOND_L:
+            apply_preconditioner_msr_matrix(n, a->A, a->I, a->v, a->r, 1, p, k);
+            break;
+        case BENCH_FILL_A:
+            fill_A(a->nx, a->ny, hx, hy, a->I, a->A, p, k);
+            break;
+        case BENCH_FILL_B:
+            fill_B(a->nx, a->ny, hx, hy, a->a, a->c, a->B, a->f, p, k);
+            break;
+        case BENCH_R1:
+            sink = r1(a->nx, a->ny, a->a, a->c, hx, hy, a->x, a->f, p, k);
+            break;
+        case BENCH_R2:
+            sink = r2(a->nx, a->ny, a->a, a->c, hx, hy, a->x, a->f, p, k);
+            break;
+        case BENCH_R3:
+            sink = r3(a->nx, a->ny, a->a, a->c, hx, hy, a->x, a->f, p, k);
+            break;
+        case BENCH_R4:
+            sink = r4(a->nx, a->ny, a->a, a->c, hx, hy, a->x, a->f, p, k);
+            break;
+    }
+    (void)sink;
+}
+
+static void* bench_thread(void* ptr) {
+    BenchArgs* b = (BenchArgs*)ptr;
+    Args* a = &b->solver;
+    const double hx = (a->b - a->a) / a->nx;
+    const double hy = (a->d - a->c) / a->ny;
+    const int n = (a->nx + 1) * (a->ny + 1);
+    int i1, i2;
+
+    thread_rows(n, a->p, a->k, i1, i2);
+    for (int i = i1; i < i2; ++i) {
+        a->x[i] = 1.0 + 1e-3 * (i % 7);
+        a->r[i] = 1.0;
+        a->u[i] = 0.5;
+        a->v[i] = 0.0;
+    }
+    fill_A(a->nx, a->ny, hx, hy, a->I, a->A, a->p, a->k);
+
+    PerfGroup group;
+    const bool counting = b->events != nullptr && perf_group_open(&group) == 0;
+    long long before[PERF_COUNT], after[PERF_COUNT];
+
+    for (int kernel = 0; kernel < BENCH_COUNT; ++kernel) {
+        // Прогрев; по его времени поток 0 выбирает число повторов для всех
+        reduce_sum<int>(a->p);
+        double t = wall_time();
+        run_kernel(kernel, a, hx, hy);
+        reduce_sum<int>(a->p);
+        int reps = 0;
+        if (a->k == 0) {
+            reps = (int)std::min(std::max(b->target / (wall_time() - t), 3.0), 1e6);
+        }
+        reduce_sum(a->p, &reps, 1);
+
+        if (counting) {
+            perf_group_read(&group, before);
+        }
+        t = wall_time();
+        for (int rep = 0; rep < reps; ++rep) {
+            run_kernel(kernel, a, hx, hy);
+        }
+        if (counting) {
+            perf_group_read(&group, after);
+        }
+        reduce_sum<int>(a->p);
+        if (a->k == 0) {
+            b->seconds[kernel] = (wall_time() - t) / reps;
+        }
+        if (b->events != nullptr) {
+            double* events = b->events + ((size_t)a->k * BENCH_COUNT + kernel) * PERF_COUNT;
+            for (int e = 0; e < PERF_COUNT; ++e) {
+                events[e] = counting && after[e] >= 0 ? (double)(after[e] - before[e]) / reps : -1;
+            }
+        }
+    }
+
+    if (counting) {
+        perf_group_close(&group);
+    }
+
+    return nullptr;
+}
+
+// Модель трафика и арифметики ядра на сетке с n узлами и nnz внедиагональными элементами
+static void kernel_model(int kernel, double n, double nnz, double* bytes, double* flops) {
+    const double row = 8.0 * (n + nnz) + 4.0 * (n + 1 + nnz);   // A и I
+    *bytes = 0;
+    *flops = 0;
+    switch (kernel) {
+        case BENCH_MATVEC:
+            *bytes = row + 16.0 * n;
+            *flops = 2.0 * (n + nnz);
+            break;
+        case BENCH_DOT:
+            *bytes = 16.0 * n;
+            *flops = 2.0 * n;
+            break;
+        case BENCH_AXPY:
+            *bytes = 24.0 * n;
+            *flops = 2.0 * n;
+            break;
+        case BENCH_PRECOND_R:
+        case BENCH_PRECOND_L:
+            *bytes = row + 16.0 * n;
+            *flops = nnz + 3.0 * n;
+            break;
+        case BENCH_FILL_A:
+            *bytes = 8.0 * (n + nnz) + 4.0 * n;
+            break;
+        case BENCH_FILL_B:
+            *bytes = 8.0 * n;
+            break;
+        case BENCH_R1:
+        case BENCH_R2:
+            *bytes = 8.0 * n;
+            *flops = 10.0 * n;
+            break;
+        case BENCH_R3:
+        case BENCH_R4:
+            *bytes = 8.0 * n;
+            *flops = 2.0 * n;
+            break;
+    }
+}
+
+struct StreamArgs {
+    double* a;
+    double* b;
+    double* c;
+    long long n;
+    int p;
+    int k;
+    int reps;
+    double* best;
+};
+
+static void* stream_thread(void* ptr) {
+    StreamArgs* s = (StreamArgs*)ptr;
+    const long long i1 = s->n * s->k / s->p, i2 = s->n * (s->k + 1) / s->p;
+    const double scalar = 3.0;
+
+    for (long long i = i1; i < i2; ++i) {
+        s->a[i] = 0;
+        s->b[i] = 1.0;
+        s->c[i] = 2.0;
+    }
+
+    for (int rep = 0; rep < s->reps; ++rep) {
+        reduce_sum<int>(s->p);
+        double t = wall_time();
+        for (long long i = i1; i < i2; ++i) {
+            s->a[i] = s->b[i] + scalar * s->c[i];
+        }
+        reduce_sum<int>(s->p);
+        if (s->k == 0) {
+            *s->best = std::min(*s->best, wall_time() - t);
+        }
+    }
+
+    return nullptr;
+}
+
+// STREAM triad a = b + s*c на массивах, заведомо больших кэша; возвращает GB/s
+static double stream_triad(int p, long long n) {
+    double* a = new double[n];
+    double* b = new double[n];
+    double* c = new double[n];
+    double best = 1e30;
+    std::vector<StreamArgs> args(p);
+    std::vector<pthread_t> threads(p);
+
+    for (int k = 0; k < p; ++k) {
+        args[k] = {a, b, c, n, p, k, 10, &best};
+    }
+    for (int k = 1; k < p; ++k) {
+        pthread_create(&threads[k], nullptr, &stream_thread, &args[k]);
+    }
+    stream_thread(&args[0]);
+    for (int k = 1; k < p; ++k) {
+        pthread_join(threads[k], nullptr);
+    }
+
+    delete[] a;
+    delete[] b;
+    delete[] c;
+    return 24.0 * n / best * 1e-9;
+}
+
+static std::vector<int> parse_list(const char* s) {
+    std::vector<int> list;
+    std::string str(s);
+    size_t pos = 0;
+    while (pos <= str.size()) {
+        size_t next = str.find(',', pos);
+        if (next == std::string::npos) {
+            next = str.size();
+        }
+        list.push_back(std::stoi(str.substr(pos, next - pos)));
+        pos = next + 1;
+    }
+    return list;
+}
+
+// Сумма по потокам событий на вызов; байты промахов LLC сравниваются с моделью
+static void print_events(int nx, int p, const double* events, const double* seconds) {
+    printf("# hardware counters per call, nx = %d, p = %d\n", nx, p);
+    printf("%-16s", "kernel");
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        printf(" %12s", perf_counter_name(e));
+    }
+    printf(" %6s %8s\n", "IPC", "LLC GB/s");
+
+    for (int kernel = 0; kernel < BENCH_COUNT; ++kernel) {
+        double sum[PERF_COUNT] = {0};
+        bool present[PERF_COUNT];
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            present[e] = true;
+            for (int t = 0; t < p; ++t) {
+                const double v = events[((size_t)t * BENCH_COUNT + kernel) * PERF_COUNT + e];
+                present[e] = present[e] && v >= 0;
+                sum[e] += v;
+            }
+        }
+
+        printf("%-16s", bench_names[kernel]);
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            if (present[e]) {
+                printf(" %12.0f", sum[e]);
+            } else {
+                printf(" %12s", "-");
+            }
+        }
+        if (present[PERF_CYCLES] && present[PERF_INSTRUCTIONS] && sum[PERF_CYCLES] > 0) {
+            printf(" %6.2f", sum[PERF_INSTRUCTIONS] / sum[PERF_CYCLES]);
+        } else {
+            printf(" %6s", "-");
+        }
+        if (present[PERF_LLC_MISSES]) {
+            printf(" %8.2f\n", sum[PERF_LLC_MISSES] * PERF_LINE_BYTES / seconds[kernel] * 1e-9);
+        } else {
+            printf(" %8s\n", "-");
+        }
+    }
+}
+
+static int bench_grid(int nx, int p, double stream_gbs, int k, bool perf) {
+    const int n = (nx + 1) * (nx + 1);
+    Functions func;
+    func.select_f(k);
+
+    if (init_tiling(nx, nx, p)) {
+        return 2;
+    }
+
+    Arena arena;
+    int* I = nullptr;
+    double* A = nullptr;
+    double* vectors[5];
+    if (arena_reserve(&arena, solver_arena_size(nx, nx, 5))
+        || allocate_solver_buffers(&arena, nx, nx, 5, &A, &I, vectors)) {
+        free_tiling();
+        arena_release(&arena);
+        return 2;
+    }
+    fill_I(nx, nx, I);
+
+    double seconds[BENCH_COUNT];
+    std::vector<double> events(perf ? (size_t)p * BENCH_COUNT * PERF_COUNT : 0);
+    std::vector<BenchArgs> args(p);
+    std::vector<pthread_t> threads(p);
+
+    for (int t = 0; t < p; ++t) {
+        Args& a = args[t].solver;
+        a.a = -1;
+        a.b = 1;
+        a.c = -1;
+        a.d = 1;
+        a.I = I;
+        a.A = A;
+        a.B = vectors[0];
+        a.x = vectors[1];
+        a.r = vectors[2];
+        a.u = vectors[3];
+        a.v = vectors[4];
+        a.nx = nx;
+        a.ny = nx;
+        a.p = p;
+        a.k = t;
+        a.f = func.f;
+        args[t].target = 0.2;
+        args[t].seconds = seconds;
+        args[t].events = perf ? events.data() : nullptr;
+    }
+    for (int t = 1; t < p; ++t) {
+        pthread_create(&threads[t], nullptr, &bench_thread, &args[t]);
+    }
+    bench_thread(&args[0]);
+    for (int t = 1; t < p; ++t) {
+        pthread_join(threads[t], nullptr);
+    }
+
+    const double nnz = (double)get_len_msr(nx, nx) - n;
+    for (int kernel = 0; kernel < BENCH_COUNT; ++kernel) {
+        double bytes, flops;
+        kernel_model(kernel, n, nnz, &bytes, &flops);
+        const double s = seconds[kernel];
+        const double gbs = bytes / s * 1e-9;
+        const double gflops = flops / s * 1e-9;
+        const double ai = bytes > 0 ? flops / bytes : 0;
+
+        printf("%-16s %6d %3d %12.1f", bench_names[kernel], nx, p, s * 1e9);
+        if (bytes > 0) {
+            printf(" %8.2f %8.3f %6.1f%% %6.3f %8.3f\n", gbs, gflops, 100.0 * gbs / stream_gbs,
+                ai, ai * stream_gbs);
+        } else {
+            printf(" %8s %8s %7s %6s %8s\n", "-", "-", "-", "-", "-");
+        }
+    }
+
+    if (perf) {
+        print_events(nx, p, events.data(), seconds);
+    }
+
+    free_tiling();
+    arena_release(&arena);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes = {100, 300, 1000};
+    std::vector<int> threads = {1, 2, 4};
+    int k = 5;
+    bool perf = false;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+                sizes = parse_list(argv[++i]);
+            } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                threads = parse_list(argv[++i]);
+            } else if (strcmp(argv[i], "--function") == 0 && i + 1 < argc) {
+                k = std::stoi(argv[++i]);
+            } else if (strcmp(argv[i], "--perf") == 0) {
+                perf = true;
+            } else {
+                throw std::invalid_argument(argv[i]);
+            }
+        }
+    } catch (const std::exception&) {
+        fprintf(stderr, "Usage: %s [--sizes N1,N2,...] [--threads P1,P2,...] [--function K] [--perf]\n", argv[0]);
+        return 1;
+    }
+
+    int max_p = 1;
+    for (int p : threads) {
+        if (p < 1) {
+            fprintf(stderr, "Error: Thread counts must be positive.\n");
+            return 1;
+        }
+        max_p = std::max(max_p, p);
+    }
+    init_reduce_sum(max_p);
+
+    if (perf) {
+        PerfGroup probe;
+        if (perf_group_open(&probe)) {
+            fprintf(stderr, "Warning: Hardware counters are unavailable (%s), reporting timings only.\n", strerror(errno));
+            perf = false;
+        } else {
+            perf_group_close(&probe);
+        }
+    }
+
+    for (int p : threads) {
+        // 3 массива по 256 МБ -- больше кэша последнего уровня
+        const double stream_gbs = stream_triad(p, 1LL << 25);
+        printf("# STREAM triad, %d threads: %.2f GB/s\n", p, stream_gbs);
+        printf("%-16s %6s %3s %12s %8s %8s %7s %6s %8s\n",
+            "kernel", "nx", "p", "ns/op", "GB/s", "GFLOP/s", "STREAM", "AI", "roof");
+
+        for (int nx : sizes) {
+            if (bench_grid(nx, p, stream_gbs, k, perf)) {
+                fprintf(stderr, "Error: Failed to allocate buffers for nx = %d.\n", nx);
+                free_results();
+                return 2;
+            }
+        }
+        printf("\n");
+    }
+
+    free_results();
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include "all_includes.h"
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <new>
+
+// Копия вектора в буфер снимка в естественном порядке узлов: каждый поток копирует свою плитку
+static void gather_natural(int nx, int ny, const double* src, double* dst, int p, int k) {
+    int i1, i2, j1, j2;
+    if (!tiling_renumbers(nx, ny)) {
+        thread_rows((nx + 1) * (ny + 1), p, k, i1, i2);
+        memcpy(dst + i1, src + i1, (size_t)(i2 - i1) * sizeof(double));
+        return;
+    }
+
+    get_tile(k, i1, i2, j1, j2);
+    int l = get_tiling()->offset[k];
+    for (int j = j1; j < j2; ++j) {
+        for (int i = i1; i < i2; ++i) {
+            dst[i + j * (nx + 1)] = src[l++];
+        }
+    }
+}
+
+// Снимок пишется во временный файл и переименовывается, так что на диске
+// всегда лежит последний целый снимок
+static int write_snapshot(Checkpoint* ckpt) {
+    std::string tmp = std::string(ckpt->path) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    bool ok = fwrite(&ckpt->header, sizeof(CheckpointHeader), 1, fp) == 1
+           && fwrite(ckpt->x, sizeof(double), ckpt->n, fp) == (size_t)ckpt->n
+           && fwrite(ckpt->r, sizeof(double), ckpt->n, fp) == (size_t)ckpt->n
+           && fflush(fp) == 0
+           && fsync(fileno(fp)) == 0;
+    ok = fclose(fp) == 0 && ok;
+
+    if (!ok || rename(tmp.c_str(), ckpt->path) != 0) {
+        unlink(tmp.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+static void* checkpoint_writer(void* ptr) {
+    Checkpoint* ckpt = (Checkpoint*)ptr;
+
+    pthread_mutex_lock(&ckpt->mutex);
+    for (;;) {
+        while (!ckpt->pending && !ckpt->stop) {
+            pthread_cond_wait(&ckpt->cond, &ckpt->mutex);
+        }
+        if (!ckpt->pending) {
+            break;
+        }
+
+        pthread_mutex_unlock(&ckpt->mutex);
+        int res = write_snapshot(ckpt);
+        pthread_mutex_lock(&ckpt->mutex);
+
+        if (res != 0) {
+            ckpt->failed++;
+        } else {
+            ckpt->written++;
+        }
+        ckpt->pending = false;
+    }
+    pthread_mutex_unlock(&ckpt->mutex);
+
+    return nullptr;
+}
+
+int checkpoint_open(Checkpoint* ckpt, const char* path, int every, const CheckpointHeader* params) {
+    ckpt->path = path;
+    ckpt->every = std::max(every, 1);
+    ckpt->n = (params->nx + 1) * (params->ny + 1);
+    ckpt->header = *params;
+    memcpy(ckpt->header.magic, CHECKPOINT_MAGIC, sizeof(ckpt->header.magic));
+    ckpt->header.attempt = 0;
+    ckpt->header.iterations = 0;
+    ckpt->last_iterations = 0;
+    ckpt->resume_attempt = 0;
+    ckpt->resume_iterations = 0;
+    ckpt->written = 0;
+    ckpt->skipped = 0;
+    ckpt->failed = 0;
+    ckpt->pending = false;
+    ckpt->stop = false;
+    ckpt->x = nullptr;
+    ckpt->r = nullptr;
+
+    try {
+        ckpt->x = new double[ckpt->n];
+        ckpt->r = new double[ckpt->n];
+    } catch (std::bad_alloc&) {
+        delete[] ckpt->x;
+        ckpt->x = nullptr;
+        return -1;
+    }
+
+    pthread_mutex_init(&ckpt->mutex, nullptr);
+    pthread_cond_init(&ckpt->cond, nullptr);
+    if (pthread_create(&ckpt->writer, nullptr, &checkpoint_writer, ckpt) != 0) {
+        pthread_mutex_destroy(&ckpt->mutex);
+        pthread_cond_destroy(&ckpt->cond);
+        delete[] ckpt->x;
+        delete[] ckpt->r;
+        ckpt->x = nullptr;
+        ckpt->r = nullptr;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Дожидается записи последнего снимка и останавливает поток записи
+void checkpoint_close(Checkpoint* ckpt) {
+    pthread_mutex_lock(&ckpt->mutex);
+    ckpt->stop = true;
+    pthread_cond_signal(&ckpt->cond);
+    pthread_mutex_unlock(&ckpt->mutex);
+
+    pthread_join(ckpt->writer, nullptr);
+    pthread_mutex_destroy(&ckpt->mutex);
+    pthread_cond_destroy(&ckpt->cond);
+    delete[] ckpt->x;
+    delete[] ckpt->r;
+    ckpt->x = nullptr;
+    ckpt->r = nullptr;
+}
+
+// Вызывается всеми потоками между итерациями метода, когда x и r согласованы;
+// attempt -- число завершённых перезапусков
+void checkpoint_save(Checkpoint* ckpt, int nx, int ny, double* x, double* r,
+    int attempt, int iterations, int p, int k) {
+    if (ckpt == nullptr || iterations - ckpt->last_iterations < ckpt->every) {
+        return;
+    }
+
+    // Занят ли писатель, решает поток 0 и сообщает остальным
+    int busy = 0;
+    if (k == 0) {
+        pthread_mutex_lock(&ckpt->mutex);
+        busy = ckpt->pending ? 1 : 0;
+        pthread_mutex_unlock(&ckpt->mutex);
+    }
+    reduce_sum(p, &busy, 1);
+
+    if (busy) {
+        if (k == 0) {
+            ckpt->skipped++;
+        }
+        return;
+    }
+
+    gather_natural(nx, ny, x, ckpt->x, p, k);
+    gather_natural(nx, ny, r, ckpt->r, p, k);
+    reduce_sum<int>(p);
+
+    if (k == 0) {
+        pthread_mutex_lock(&ckpt->mutex);
+        ckpt->header.attempt = attempt;
+        ckpt->header.iterations = iterations;
+        ckpt->last_iterations = iterations;
+        ckpt->pending = true;
+        pthread_cond_signal(&ckpt->cond);
+        pthread_mutex_unlock(&ckpt->mutex);
+    }
+}
+
+// Читает x из снимка ckpt->path в естественном порядке. Сетка, функция и область
+// должны совпадать с параметрами ckpt->header; eps и maxit можно менять.
+// Возвращает -1, если файл не читается, -2 при несовпадении параметров.
+int checkpoint_load(Checkpoint* ckpt, double* x) {
+    FILE* fp = fopen(ckpt->path, "rb");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    CheckpointHeader h;
+    if (fread(&h, sizeof(h), 1, fp) != 1) {
+        fclose(fp);
+        return -1;
+    }
+
+    // Границы области сравниваются побитно: они разобраны из тех же строк аргументов
+    const CheckpointHeader& e = ckpt->header;
+    if (memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0
+        || h.nx != e.nx || h.ny != e.ny || h.k != e.k
+        || memcmp(&h.a, &e.a, 4 * sizeof(double)) != 0) {
+        fclose(fp);
+        return -2;
+    }
+
+    if (fread(x, sizeof(double), ckpt->n, fp) != (size_t)ckpt->n) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    ckpt->resume_attempt = h.attempt;
+    ckpt->resume_iterations = h.iterations;
+    ckpt->last_iterations = h.iterations;
+    return 0;
+}
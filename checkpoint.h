@@ -0,0 +1,53 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <pthread.h>
+
+#define CHECKPOINT_MAGIC "A2DCKPT1"
+
+// Заголовок файла контрольной точки; за ним идут x и r длины n в естественном порядке узлов
+struct CheckpointHeader {
+    char magic[8];
+    int nx;
+    int ny;
+    int k;              // Номер функции
+    int maxit;
+    double a;
+    double b;
+    double c;
+    double d;
+    double eps;
+    int attempt;        // Число завершённых перезапусков метода
+    int iterations;     // Число выполненных итераций
+};
+
+// Периодические снимки решения. Потоки решателя только копируют x и r в буфер
+// и продолжают счёт, файл пишет отдельный поток. Если он ещё занят предыдущим
+// снимком, очередной снимок пропускается.
+struct Checkpoint {
+    const char* path;
+    int every;          // Итераций между снимками
+    int n;
+    double* x;          // Буфер снимка
+    double* r;
+    CheckpointHeader header;
+    int last_iterations;
+    int resume_attempt;
+    int resume_iterations;
+    int written;
+    int skipped;
+    int failed;
+    bool pending;
+    bool stop;
+    pthread_t writer;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+int checkpoint_open(Checkpoint* ckpt, const char* path, int every, const CheckpointHeader* params);
+void checkpoint_close(Checkpoint* ckpt);
+void checkpoint_save(Checkpoint* ckpt, int nx, int ny, double* x, double* r,
+    int attempt, int iterations, int p, int k);
+int checkpoint_load(Checkpoint* ckpt, double* x);
+
+#endif // CHECKPOINT_H
@@ -15,6 +15,7 @@ struct Args{
     double d;
     double eps;
     int* I;
+    long long* I64 = nullptr;   // Индексы MSR для сеток с числом ненулевых больше INT_MAX, тогда I не используется
     double* A;
     double* B;
     double* x;
@@ -27,9 +28,18 @@ struct Args{
     int p;
     int k;
     double (*f)(double, double);
+    int sstep = 0;          // Длина блока s-шагового метода, 0 -- метод минимальных ошибок
+    double* V = nullptr;    // Базис s-шагового метода, (sstep + 1) векторов
+    double* ring = nullptr; // Кольцевые буферы s-шагового метода, sstep_ring_length на поток
+    struct Checkpoint* ckpt = nullptr;  // Контрольные точки, nullptr -- без них
+    double* node_errors = nullptr;      // Поля ошибок для файла решения, nullptr -- не нужны
+    double* triangle_errors = nullptr;
+    double* cell_errors = nullptr;      // Погрешность по ячейкам для визуализации, считается в r1
+    struct History* history = nullptr;  // История сходимости, nullptr -- не записывается
     int its = 0;
     double t1 = 0;
     double t2 = 0;
+    double wall = 0;        // Время solution() по часам, с; пишет поток окна GUI
     double res_1 = 0;
     double res_2 = 0;
     double res_3 = 0;
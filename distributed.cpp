@@ -0,0 +1,673 @@
+#include "all_includes.h"
+#include "distributed.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/sysinfo.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+static void dist_fail(const char* what) {
+    fprintf(stderr, "Distributed solver: %s failed: %s\n", what, strerror(errno));
+    _exit(3);
+}
+
+// Транспорт через общую память: барьер и почтовые ящики в одном MAP_SHARED отображении
+class ShmTransport : public Transport {
+public:
+    ShmTransport(int nprocs, int row_len) : nprocs(nprocs), row_len(row_len), rank(0),
+                                            region(nullptr), region_size(0), barrier(nullptr),
+                                            slots(nullptr), boxes(nullptr) {}
+
+    // Вызывается только родителем, когда все процессы завершены. Барьер не
+    // разрушается: после завершения процесса внутри барьера destroy ждал бы
+    // его вечно, а своих ресурсов у барьера нет, хватает munmap
+    ~ShmTransport() override {
+        if (region != nullptr) {
+            munmap(region, region_size);
+        }
+    }
+
+    int init() {
+        size_t header = (sizeof(pthread_barrier_t) + 63) / 64 * 64;
+        size_t slots_size = ((size_t)nprocs * sizeof(double) + 63) / 64 * 64;
+        region_size = header + slots_size + (size_t)nprocs * 2 * row_len * sizeof(double);
+
+        region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            region = nullptr;
+            return -1;
+        }
+
+        barrier = (pthread_barrier_t*)region;
+        slots = (double*)((char*)region + header);
+        boxes = (double*)((char*)region + header + slots_size);
+
+        pthread_barrierattr_t attr;
+        pthread_barrierattr_init(&attr);
+        pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        int status = pthread_barrier_init(barrier, &attr, nprocs);
+        pthread_barrierattr_destroy(&attr);
+        return status == 0 ? 0 : -1;
+    }
+
+    int attach(int rank) override {
+        this->rank = rank;
+        return 0;
+    }
+
+    // Процесс, застрявший на барьере после падения соседа, завершает родитель
+    void detach() override {
+        rank = -1;
+    }
+
+    void halo_exchange(double* send_down, double* recv_down,
+                       double* send_up, double* recv_up, int n) override {
+        if (send_down) {
+            memcpy(box(rank, 0), send_down, n * sizeof(double));
+        }
+        if (send_up) {
+            memcpy(box(rank, 1), send_up, n * sizeof(double));
+        }
+        pthread_barrier_wait(barrier);
+
+        if (recv_down) {
+            memcpy(recv_down, box(rank - 1, 1), n * sizeof(double));
+        }
+        if (recv_up) {
+            memcpy(recv_up, box(rank + 1, 0), n * sizeof(double));
+        }
+        pthread_barrier_wait(barrier);
+    }
+
+    double allreduce_sum(double s) override {
+        slots[rank] = s;
+        pthread_barrier_wait(barrier);
+        double sum = 0;
+        for (int l = 0; l < nprocs; ++l) {
+            sum += slots[l];
+        }
+        pthread_barrier_wait(barrier);
+        return sum;
+    }
+
+    double allreduce_max(double s) override {
+        slots[rank] = s;
+        pthread_barrier_wait(barrier);
+        double m = slots[0];
+        for (int l = 1; l < nprocs; ++l) {
+            m = std::max(m, slots[l]);
+        }
+        pthread_barrier_wait(barrier);
+        return m;
+    }
+
+private:
+    int nprocs;
+    int row_len;
+    int rank;
+    void* region;
+    size_t region_size;
+    pthread_barrier_t* barrier;
+    double* slots;
+    double* boxes;
+
+    double* box(int owner, int dir) {
+        return boxes + ((size_t)owner * 2 + dir) * row_len;
+    }
+};
+
+static void write_all(int fd, const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            dist_fail("write");
+        }
+        p += w;
+        len -= w;
+    }
+}
+
+static void read_all(int fd, void* buf, size_t len) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t r = read(fd, p, len);
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            dist_fail("read");
+        }
+        if (r == 0) {
+            errno = EPIPE;
+            dist_fail("read");
+        }
+        p += r;
+        len -= r;
+    }
+}
+
+// Транспорт через Unix-сокеты: socketpair на каждое ребро (r, r+1) для теневых строк
+// и звезда вокруг процесса 0 для редукций
+class SocketTransport : public Transport {
+public:
+    SocketTransport(int nprocs) : nprocs(nprocs), rank(0), halo_fd(nullptr), red_fd(nullptr) {}
+
+    ~SocketTransport() override {
+        if (halo_fd != nullptr) {
+            for (int l = 0; l < 2 * nprocs; ++l) {
+                if (halo_fd[l] >= 0) {
+                    close(halo_fd[l]);
+                }
+                if (red_fd[l] >= 0) {
+                    close(red_fd[l]);
+                }
+            }
+        }
+        delete[] halo_fd;
+        delete[] red_fd;
+    }
+
+    int init() {
+        halo_fd = new int[2 * nprocs];
+        red_fd = new int[2 * nprocs];
+        for (int l = 0; l < 2 * nprocs; ++l) {
+            halo_fd[l] = -1;
+            red_fd[l] = -1;
+        }
+
+        // halo_fd[2r], halo_fd[2r + 1] -- концы ребра (r, r+1) у процессов r и r+1
+        // red_fd[2r], red_fd[2r + 1] -- концы канала (0, r) у процессов 0 и r
+        for (int r = 0; r < nprocs; ++r) {
+            if (r + 1 < nprocs && socketpair(AF_UNIX, SOCK_STREAM, 0, &halo_fd[2 * r]) != 0) {
+                return -1;
+            }
+            if (r > 0 && socketpair(AF_UNIX, SOCK_STREAM, 0, &red_fd[2 * r]) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int attach(int rank) override {
+        this->rank = rank;
+
+        // Закрываем чужие концы, чтобы падение соседа давало EOF, а не зависание
+        for (int r = 0; r < nprocs; ++r) {
+            if (r != rank && halo_fd[2 * r] >= 0) {
+                close(halo_fd[2 * r]);
+                halo_fd[2 * r] = -1;
+            }
+            if (r + 1 != rank && halo_fd[2 * r + 1] >= 0) {
+                close(halo_fd[2 * r + 1]);
+                halo_fd[2 * r + 1] = -1;
+            }
+            if (rank != 0 && red_fd[2 * r] >= 0) {
+                close(red_fd[2 * r]);
+                red_fd[2 * r] = -1;
+            }
+            if (r != rank && red_fd[2 * r + 1] >= 0) {
+                close(red_fd[2 * r + 1]);
+                red_fd[2 * r + 1] = -1;
+            }
+        }
+        return 0;
+    }
+
+    void detach() override {
+        for (int l = 0; l < 2 * nprocs; ++l) {
+            if (halo_fd[l] >= 0) {
+                close(halo_fd[l]);
+                halo_fd[l] = -1;
+            }
+            if (red_fd[l] >= 0) {
+                close(red_fd[l]);
+                red_fd[l] = -1;
+            }
+        }
+    }
+
+    void halo_exchange(double* send_down, double* recv_down,
+                       double* send_up, double* recv_up, int n) override {
+        size_t len = n * sizeof(double);
+
+        // Две фазы по чётности нижнего конца ребра: в каждой фазе процесс занят
+        // не более чем одним ребром, нижний конец сначала пишет, верхний сначала читает
+        for (int phase = 0; phase < 2; ++phase) {
+            if (send_up && rank % 2 == phase) {
+                write_all(halo_fd[2 * rank], send_up, len);
+                read_all(halo_fd[2 * rank], recv_up, len);
+            }
+            if (send_down && (rank - 1) % 2 == phase) {
+                read_all(halo_fd[2 * (rank - 1) + 1], recv_down, len);
+                write_all(halo_fd[2 * (rank - 1) + 1], send_down, len);
+            }
+        }
+    }
+
+    double allreduce_sum(double s) override {
+        return allreduce(s, false);
+    }
+
+    double allreduce_max(double s) override {
+        return allreduce(s, true);
+    }
+
+private:
+    int nprocs;
+    int rank;
+    int* halo_fd;
+    int* red_fd;
+
+    double allreduce(double s, bool use_max) {
+        if (rank != 0) {
+            write_all(red_fd[2 * rank + 1], &s, sizeof(s));
+            read_all(red_fd[2 * rank + 1], &s, sizeof(s));
+            return s;
+        }
+
+        for (int r = 1; r < nprocs; ++r) {
+            double t;
+            read_all(red_fd[2 * r], &t, sizeof(t));
+            s = use_max ? std::max(s, t) : s + t;
+        }
+        for (int r = 1; r < nprocs; ++r) {
+            write_all(red_fd[2 * r], &s, sizeof(s));
+        }
+        return s;
+    }
+};
+
+Transport* create_transport(transport_type type, int nprocs, int row_len) {
+    if (type == transport_type::shm) {
+        ShmTransport* t = new ShmTransport(nprocs, row_len);
+        if (t->init() != 0) {
+            delete t;
+            return nullptr;
+        }
+        return t;
+    }
+
+    SocketTransport* t = new SocketTransport(nprocs);
+    if (t->init() != 0) {
+        delete t;
+        return nullptr;
+    }
+    return t;
+}
+
+int init_dist_block(DistBlock* blk, int nx, int ny, int rank, int nprocs) {
+    const int width = nx + 1;
+
+    blk->nx = nx;
+    blk->ny = ny;
+    blk->rank = rank;
+    blk->nprocs = nprocs;
+    blk->j1 = (ny + 1) * rank / nprocs;
+    blk->j2 = (ny + 1) * (rank + 1) / nprocs;
+    blk->jlo = rank > 0 ? blk->j1 - 1 : blk->j1;
+    blk->jhi = rank + 1 < nprocs ? blk->j2 + 1 : blk->j2;
+    blk->n = (blk->jhi - blk->jlo) * width;
+    blk->own_begin = (blk->j1 - blk->jlo) * width;
+    blk->own_end = (blk->j2 - blk->jlo) * width;
+
+    int offdiag_elements = 0;
+    for (int j = blk->j1; j < blk->j2; ++j) {
+        for (int i = 0; i <= nx; ++i) {
+            offdiag_elements += get_off_diag(nx, ny, i, j, nullptr);
+        }
+    }
+
+    blk->I = nullptr;
+    blk->A = nullptr;
+    blk->B = nullptr;
+    blk->x = nullptr;
+    blk->r = nullptr;
+    blk->u = nullptr;
+    blk->v = nullptr;
+
+    try {
+        blk->I = new int[blk->n + 1 + offdiag_elements];
+        blk->A = new double[blk->n + 1 + offdiag_elements];
+        blk->B = new double[blk->n];
+        blk->x = new double[blk->n];
+        blk->r = new double[blk->n];
+        blk->u = new double[blk->n];
+        blk->v = new double[blk->n];
+    } catch (std::bad_alloc&) {
+        free_dist_block(blk);
+        return 1;
+    }
+
+    // Локальная нумерация: l = i + (j - jlo)*(nx + 1); у теневых строк нет внедиагональных элементов
+    int current_offset = blk->n + 1;
+    int neighbors[6];
+    for (int l = 0; l < blk->n; ++l) {
+        blk->I[l] = current_offset;
+        if (l < blk->own_begin || l >= blk->own_end) {
+            blk->A[l] = 1.0;
+            continue;
+        }
+
+        int i = l % width;
+        int j = blk->jlo + l / width;
+        int count = get_off_diag(nx, ny, i, j, neighbors);
+        for (int m = 0; m < count; ++m) {
+            blk->I[current_offset + m] = neighbors[m] - blk->jlo * width;
+        }
+        current_offset += count;
+    }
+    blk->I[blk->n] = current_offset;
+
+    memset(blk->x, 0, blk->n * sizeof(double));
+    return 0;
+}
+
+void free_dist_block(DistBlock* blk) {
+    delete[] blk->I;
+    delete[] blk->A;
+    delete[] blk->B;
+    delete[] blk->x;
+    delete[] blk->r;
+    delete[] blk->u;
+    delete[] blk->v;
+    blk->I = nullptr;
+    blk->A = nullptr;
+    blk->B = nullptr;
+    blk->x = nullptr;
+    blk->r = nullptr;
+    blk->u = nullptr;
+    blk->v = nullptr;
+}
+
+void dist_fill_A(DistBlock* blk, double hx, double hy) {
+    const int width = blk->nx + 1;
+    for (int l = blk->own_begin; l < blk->own_end; ++l) {
+        fill_A_ij(blk->nx, blk->ny, hx, hy, l % width, blk->jlo + l / width, &blk->A[l], &blk->A[blk->I[l]]);
+    }
+}
+
+void dist_fill_B(DistBlock* blk, double hx, double hy, double a, double c, double (*f)(double, double)) {
+    const int width = blk->nx + 1;
+    for (int l = 0; l < blk->n; ++l) {
+        if (l < blk->own_begin || l >= blk->own_end) {
+            blk->B[l] = 0;
+            continue;
+        }
+        blk->B[l] = F_IJ(blk->nx, blk->ny, hx, hy, a, c, l % width, blk->jlo + l / width, f);
+    }
+}
+
+void dist_halo(DistBlock* blk, Transport* t, double* x) {
+    const int width = blk->nx + 1;
+    bool has_down = blk->rank > 0;
+    bool has_up = blk->rank + 1 < blk->nprocs;
+
+    t->halo_exchange(has_down ? &x[blk->own_begin] : nullptr,
+                     has_down ? &x[0] : nullptr,
+                     has_up ? &x[blk->own_end - width] : nullptr,
+                     has_up ? &x[blk->own_end] : nullptr,
+                     width);
+}
+
+static void dist_matvec(DistBlock* blk, Transport* t, double* x, double* y) {
+    dist_halo(blk, t, x);
+    matrix_mult_vector_msr_rows(blk->own_begin, blk->own_end, blk->A, blk->I, x, y);
+}
+
+static double dist_scalar_product(DistBlock* blk, Transport* t, double* x, double* y) {
+    double s = 0;
+    for (int i = blk->own_begin; i < blk->own_end; ++i) {
+        s += x[i] * y[i];
+    }
+    return t->allreduce_sum(s);
+}
+
+static void dist_mult_sub_vector(DistBlock* blk, double* x, double* y, double tau) {
+    for (int i = blk->own_begin; i < blk->own_end; ++i) {
+        x[i] -= tau * y[i];
+    }
+}
+
+static bool dist_step(DistBlock* blk, Transport* t, double prec) {
+    dist_matvec(blk, t, blk->v, blk->u);
+
+    const double residual_norm = dist_scalar_product(blk, t, blk->r, blk->r);
+    const double direction_norm = dist_scalar_product(blk, t, blk->u, blk->u);
+
+    if (residual_norm < prec || direction_norm < prec) {
+        return true;
+    }
+    const double step_size = residual_norm / direction_norm;
+
+    dist_mult_sub_vector(blk, blk->x, blk->v, step_size);
+    dist_mult_sub_vector(blk, blk->r, blk->u, step_size);
+
+    return false;
+}
+
+// Повторяет minimal_errors_msr_matrix; предобусловливатель блочный по строкам процесса
+static int dist_minimal_errors_msr_matrix(DistBlock* blk, Transport* t, double eps, int maxit) {
+    const double omega = 1.0;
+    int iteration_count;
+
+    const double rhs_norm_squared = dist_scalar_product(blk, t, blk->B, blk->B);
+    const double convergence_threshold = rhs_norm_squared * eps * eps;
+
+    dist_matvec(blk, t, blk->x, blk->r);
+    dist_mult_sub_vector(blk, blk->r, blk->B, 1.0);
+
+    for (iteration_count = 0; iteration_count < maxit; ++iteration_count) {
+        solve_rsystem_rows(blk->own_begin, blk->own_end, blk->I, blk->A, blk->r, blk->v, omega);
+
+        if (dist_step(blk, t, convergence_threshold)) {
+            break;
+        }
+
+        dist_matvec(blk, t, blk->x, blk->u);
+        dist_mult_sub_vector(blk, blk->u, blk->B, 1.0);
+
+        solve_lsystem_rows(blk->own_begin, blk->own_end, blk->I, blk->A, blk->u, blk->v, omega);
+
+        if (dist_step(blk, t, convergence_threshold)) {
+            break;
+        }
+    }
+
+    if (iteration_count >= maxit) {
+        return -1;
+    }
+
+    return iteration_count;
+}
+
+int dist_minimal_errors_msr_matrix_full(DistBlock* blk, Transport* t, double eps, int maxit, int maxsteps) {
+    int current_attempt;
+    int total_iterations = 0;
+
+    for (current_attempt = 0; current_attempt < maxsteps; ++current_attempt) {
+        int convergence_status = dist_minimal_errors_msr_matrix(blk, t, eps, maxit);
+
+        if (convergence_status >= 0) {
+            total_iterations += convergence_status;
+            break;
+        }
+
+        total_iterations += maxit;
+    }
+
+    if (current_attempt >= maxsteps) {
+        return -1;
+    }
+
+    return total_iterations;
+}
+
+int dist_solution(Args* args, Transport* t, int rank, int nprocs) {
+    double a = args->a; double b = args->b; double c = args->c; double d = args->d;
+    int nx = args->nx; int ny = args->ny;
+    double (*f)(double, double) = args->f;
+
+    cpu_set_t cpu;
+    CPU_ZERO(&cpu);
+    int n_cpus = get_nprocs();
+    CPU_SET(n_cpus - 1 - (rank % n_cpus), &cpu);
+    sched_setaffinity(0, sizeof(cpu), &cpu);
+
+    if (t->attach(rank) != 0) {
+        return -1;
+    }
+    init_reduce_sum(1);
+
+    DistBlock blk;
+    if (init_dist_block(&blk, nx, ny, rank, nprocs)) {
+        fprintf(stderr, "Distributed solver: rank %d failed to allocate its block\n", rank);
+        return -1;
+    }
+
+    double hx = (b - a) / nx;
+    double hy = (d - c) / ny;
+
+    dist_fill_A(&blk, hx, hy);
+    dist_fill_B(&blk, hx, hy, a, c, f);
+
+    int maxsteps = SOLVER_MAXSTEPS;
+    args->t1 = get_cpu_time();
+    int its = dist_minimal_errors_msr_matrix_full(&blk, t, args->eps, args->maxit, maxsteps);
+    args->t1 = get_cpu_time() - args->t1;
+    args->its = its;
+
+    // Невязки считаются существующими r1..r4 на подсетке процесса:
+    // для r1/r2 к собственным строкам добавляется теневая строка сверху
+    args->t2 = get_cpu_time();
+    dist_halo(&blk, t, blk.x);
+    double* x_own = &blk.x[blk.own_begin];
+    double c_own = c + blk.j1 * hy;
+    int rows_own = blk.j2 - blk.j1;
+    int rows_cells = blk.jhi - blk.j1;
+
+    double res_1 = r1(nx, rows_cells - 1, a, c_own, hx, hy, x_own, f, 1, 0);
+    double res_2 = r2(nx, rows_cells - 1, a, c_own, hx, hy, x_own, f, 1, 0);
+    double res_3 = r3(nx, rows_own - 1, a, c_own, hx, hy, x_own, f, 1, 0);
+    double res_4 = r4(nx, rows_own - 1, a, c_own, hx, hy, x_own, f, 1, 0);
+
+    args->res_1 = t->allreduce_max(res_1);
+    args->res_2 = t->allreduce_sum(res_2);
+    args->res_3 = t->allreduce_max(res_3);
+    args->res_4 = t->allreduce_sum(res_4);
+    args->t2 = get_cpu_time() - args->t2;
+
+    free_dist_block(&blk);
+    args->completed = true;
+    return 0;
+}
+
+static void kill_ranks(const pid_t* pids, int nprocs) {
+    for (int rank = 0; rank < nprocs; ++rank) {
+        if (pids[rank] > 0) {
+            kill(pids[rank], SIGKILL);
+        }
+    }
+}
+
+// Все процессы, включая процесс 0, -- дочерние. Результат процесса 0
+// возвращается через общее отображение, родитель только ждёт: ошибка или
+// падение любого процесса завершает остальные, а не оставляет их на барьере
+int run_distributed(Args* args, int nprocs, transport_type type) {
+    Transport* t = create_transport(type, nprocs, args->nx + 1);
+    if (t == nullptr) {
+        fprintf(stderr, "Distributed solver: failed to create transport: %s\n", strerror(errno));
+        return -1;
+    }
+
+    Args* result = (Args*)mmap(nullptr, sizeof(Args), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+        fprintf(stderr, "Distributed solver: mmap failed: %s\n", strerror(errno));
+        delete t;
+        return -1;
+    }
+    *result = *args;
+
+    pid_t* pids = new pid_t[nprocs];
+    int alive = 0;
+    int status = 0;
+
+    fflush(nullptr);
+    for (int rank = 0; rank < nprocs; ++rank) {
+        pids[rank] = fork();
+        if (pids[rank] == 0) {
+            Args local = *args;
+            int st = dist_solution(rank == 0 ? result : &local, t, rank, nprocs);
+            _exit(st == 0 ? 0 : 1);
+        }
+        if (pids[rank] < 0) {
+            fprintf(stderr, "Distributed solver: fork failed: %s\n", strerror(errno));
+            for (int l = rank; l < nprocs; ++l) {
+                pids[l] = 0;
+            }
+            status = -1;
+            kill_ranks(pids, nprocs);
+            break;
+        }
+        alive++;
+    }
+    t->detach();
+
+    while (alive > 0) {
+        int child_status = 0;
+        pid_t pid = waitpid(-1, &child_status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Ждать больше некого: дочерние процессы забраны кем-то ещё
+            status = -1;
+            break;
+        }
+
+        int rank = 0;
+        while (rank < nprocs && pids[rank] != pid) {
+            rank++;
+        }
+        if (rank == nprocs) {
+            continue;
+        }
+        pids[rank] = 0;
+        alive--;
+
+        if (!WIFEXITED(child_status) || WEXITSTATUS(child_status) != 0) {
+            if (status == 0) {
+                fprintf(stderr, "Distributed solver: rank %d failed, stopping the others\n", rank);
+                kill_ranks(pids, nprocs);
+            }
+            status = -1;
+        }
+    }
+
+    if (status == 0) {
+        args->its = result->its;
+        args->t1 = result->t1;
+        args->t2 = result->t2;
+        args->res_1 = result->res_1;
+        args->res_2 = result->res_2;
+        args->res_3 = result->res_3;
+        args->res_4 = result->res_4;
+        args->completed = result->completed;
+    } else {
+        args->status = Status::error;
+    }
+
+    munmap(result, sizeof(Args));
+    delete[] pids;
+    delete t;
+    return status;
+}
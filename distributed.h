@@ -0,0 +1,64 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "common_types.h"
+
+enum class transport_type {
+    shm,
+    socket
+};
+
+// Межпроцессный транспорт для распределённого режима.
+// Объект создаётся до fork(), после fork() каждый процесс вызывает attach(rank),
+// а родитель -- detach(). Родитель только ждёт процессы и при первой ошибке
+// завершает остальные: иначе они ждали бы упавшего на барьере или в read.
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual int attach(int rank) = 0;
+    // Родитель после fork() сам не считает: закрывает свои концы каналов,
+    // чтобы падение процесса давало соседям EOF
+    virtual void detach() = 0;
+    // Обмен граничными строками с соседями rank-1 (down) и rank+1 (up).
+    // Для отсутствующего соседа соответствующие указатели равны nullptr.
+    virtual void halo_exchange(double* send_down, double* recv_down,
+                               double* send_up, double* recv_up, int n) = 0;
+    // Глобальные редукции; сумма всегда накапливается в порядке номеров процессов
+    virtual double allreduce_sum(double s) = 0;
+    virtual double allreduce_max(double s) = 0;
+};
+
+Transport* create_transport(transport_type type, int nprocs, int row_len);
+
+// Блок строк сетки, принадлежащий одному процессу, вместе с теневыми строками
+struct DistBlock {
+    int nx;
+    int ny;
+    int rank;
+    int nprocs;
+    int j1, j2;            // Собственные строки узлов [j1, j2)
+    int jlo, jhi;          // Хранимые строки [jlo, jhi) с учётом теневых
+    int n;                 // Число хранимых узлов
+    int own_begin;         // Локальный индекс первого собственного узла
+    int own_end;
+    int* I;
+    double* A;
+    double* B;
+    double* x;
+    double* r;
+    double* u;
+    double* v;
+};
+
+int init_dist_block(DistBlock* blk, int nx, int ny, int rank, int nprocs);
+void free_dist_block(DistBlock* blk);
+void dist_fill_A(DistBlock* blk, double hx, double hy);
+void dist_fill_B(DistBlock* blk, double hx, double hy, double a, double c, double (*f)(double, double));
+void dist_halo(DistBlock* blk, Transport* t, double* x);
+int dist_minimal_errors_msr_matrix_full(DistBlock* blk, Transport* t, double eps, int maxit, int maxsteps);
+int dist_solution(Args* args, Transport* t, int rank, int nprocs);
+
+int run_distributed(Args* args, int nprocs, transport_type type);
+
+#endif // DISTRIBUTED_H
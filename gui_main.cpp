@@ -4,16 +4,50 @@
 #include <string>
 #include <stdexcept>
 #include <fenv.h>
+#include <cstring>
+#include <cstdlib>
 #include "window.hpp"
+#include "batch_render.hpp"
+#include "replay.hpp"
 
 int main(int argc, char *argv[]) {
     feenableexcept(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW);
     
+    // Пакетная отрисовка сохранённых решений: без окна и без дисплея
+    if (argc >= 3 && strcmp(argv[1], "--render-batch") == 0) {
+        return render_batch_main(argc, argv);
+    }
+    
+    // Параметры повтора сценария клавиш после 12 позиционных
+    const char *replayScript = nullptr;
+    const char *replayReport = nullptr;
+    int replayTimeout = 60;
+    for (int i = 13; i < argc; ++i) {
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayScript = argv[++i];
+        } else if (strcmp(argv[i], "--replay-report") == 0 && i + 1 < argc) {
+            replayReport = argv[++i];
+        } else if (strcmp(argv[i], "--replay-timeout") == 0 && i + 1 < argc) {
+            replayTimeout = atoi(argv[++i]);
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    
+    // Повтор не требует дисплея; явно заданная платформа сохраняется
+    if (replayScript != nullptr) {
+        setenv("QT_QPA_PLATFORM", "offscreen", 0);
+    }
+    
     QApplication app(argc, argv);
     
-    if (argc != 13) {
+    if (argc < 13) {
         std::cerr << "Error: Expected 12 command-line arguments." << std::endl;
         std::cerr << "Usage: " << argv[0] << " a b c d nx ny mx my k epsilon max_iterations threads" << std::endl;
+        std::cerr << "       [--replay script [--replay-report file.csv] [--replay-timeout seconds]]" << std::endl;
+        std::cerr << "   or: " << argv[0] << " --render-batch list [--render-dir DIR] [--render-size W H]"
+                  << " [--render-detail MX MY] [--render-format png|ppm] [--render-threads N]" << std::endl;
         
         QMessageBox::critical(nullptr, "Error", 
                              "Invalid number of arguments.\n\n"
@@ -89,6 +123,28 @@ int main(int argc, char *argv[]) {
     MainWindow mainWindow(a, b, c, d, nx, ny, mx, my, k, eps, max_its, p);
     mainWindow.show();
     
+    // Сценарий клавиш: после последнего окончательного кадра выводится отчёт
+    // и приложение завершается
+    if (replayScript != nullptr) {
+        std::vector<int> keys;
+        int res = read_replay_script(replayScript, &keys);
+        if (res != 0) {
+            if (res < 0) {
+                std::cerr << "Error: Cannot open replay script " << replayScript << std::endl;
+            } else {
+                std::cerr << "Error: Invalid key at " << replayScript << ":" << res << std::endl;
+            }
+            return 1;
+        }
+        if (replayTimeout < 1) {
+            std::cerr << "Error: Replay timeout must be positive." << std::endl;
+            return 1;
+        }
+        
+        Replay *replay = new Replay(&mainWindow, keys, replayReport, replayTimeout * 1000, &mainWindow);
+        replay->start();
+    }
+    
     // Run application event loop
     return app.exec();
 } 
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "history.h"
+#include "parallel_utils.h"
+#include <stdio.h>
+#include <math.h>
+#include <new>
+#include <algorithm>
+
+// Две полуитерации на итерацию и по записи на шаг сходимости, не больше HISTORY_MAX_RECORDS
+int history_capacity(int maxit, int maxsteps) {
+    const long long records = 2LL * maxit * maxsteps + 2;
+    return (int)std::min(records, (long long)HISTORY_MAX_RECORDS);
+}
+
+int history_init(History* history, int capacity) {
+    history_free(history);
+    try {
+        history->records = new HistoryRecord[capacity];
+    } catch (std::bad_alloc&) {
+        return -1;
+    }
+    history->capacity = capacity;
+    history_reset(history);
+    return 0;
+}
+
+// Вызывается до запуска потоков решателя
+void history_reset(History* history) {
+    history->count.store(0, std::memory_order_relaxed);
+    history->dropped = 0;
+    history->restart = 0;
+    history->rhs_norm = 0;
+    history->start = wall_time();
+}
+
+void history_free(History* history) {
+    delete[] history->records;
+    history->records = nullptr;
+    history->capacity = 0;
+    history->count.store(0, std::memory_order_relaxed);
+}
+
+// residual_norm -- квадрат нормы невязки, как его считает step()
+void history_record(History* history, double residual_norm, double step_size) {
+    const int q = history->count.load(std::memory_order_relaxed);
+    if (q >= history->capacity) {
+        history->dropped++;
+        return;
+    }
+
+    HistoryRecord& rec = history->records[q];
+    rec.iteration = q;
+    rec.restart = history->restart;
+    rec.residual = sqrt(residual_norm);
+    rec.step = step_size;
+    rec.time = wall_time() - history->start;
+    history->count.store(q + 1, std::memory_order_release);
+}
+
+int history_write(const History* history, const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    const int count = history->count.load(std::memory_order_acquire);
+    fprintf(fp, "iteration,restart,residual,relative,step,time\n");
+    for (int q = 0; q < count; ++q) {
+        const HistoryRecord& rec = history->records[q];
+        fprintf(fp, "%d,%d,%e,%e,%e,%.6f\n", rec.iteration, rec.restart, rec.residual,
+            history->rhs_norm > 0 ? rec.residual / history->rhs_norm : rec.residual, rec.step, rec.time);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
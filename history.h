@@ -0,0 +1,38 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <atomic>
+
+// История сходимости метода минимальных ошибок: одна запись на каждый шаг
+// step(), то есть на полуитерацию. Буфер выделяется заранее на весь расчёт,
+// пишет только поток 0, поэтому на горячем пути нет ни синхронизации, ни
+// выделения памяти. Счётчик записей публикуется с release-семантикой, и
+// интерфейс может читать первые count записей во время счёта.
+#define HISTORY_MAX_RECORDS (1 << 22)
+
+struct HistoryRecord {
+    int iteration;      // Номер полуитерации с начала расчёта
+    int restart;        // Номер перезапуска метода
+    double residual;    // ||r||
+    double step;        // tau; 0 на шаге, где зафиксирована сходимость
+    double time;        // Секунды от начала расчёта
+};
+
+struct History {
+    HistoryRecord* records = nullptr;
+    int capacity = 0;
+    std::atomic<int> count{0};
+    int dropped = 0;        // Записи, не поместившиеся в буфер
+    int restart = 0;
+    double rhs_norm = 0;    // ||b||, для относительной невязки
+    double start = 0;
+};
+
+int history_capacity(int maxit, int maxsteps);
+int history_init(History* history, int capacity);
+void history_reset(History* history);
+void history_free(History* history);
+void history_record(History* history, double residual_norm, double step_size);
+int history_write(const History* history, const char* path);
+
+#endif // HISTORY_H
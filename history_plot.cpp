@@ -0,0 +1,90 @@
+#include "history_plot.hpp"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QPainterPath>
+#include <cmath>
+#include <algorithm>
+
+HistoryPlot::HistoryPlot(QWidget *parent)
+    : QWidget(parent),
+      history(nullptr),
+      shown(0) {
+    setAutoFillBackground(true);
+    QPalette pal = palette();
+    pal.setColor(QPalette::Window, QColor("#FFFFFF"));
+    setPalette(pal);
+    setMinimumHeight(120);
+    setMaximumHeight(160);
+}
+
+void HistoryPlot::setHistory(const History *history) {
+    this->history = history;
+    shown = -1;
+    refresh();
+}
+
+// Вызывается по таймеру окна
+void HistoryPlot::refresh() {
+    const int count = history != nullptr ? history->count.load(std::memory_order_acquire) : 0;
+    if (count != shown) {
+        shown = count;
+        update();
+    }
+}
+
+void HistoryPlot::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    const QRectF area = QRectF(rect()).adjusted(48, 8, -8, -20);
+    painter.setPen(QPen(QColor("#8080A0"), 1));
+    painter.drawRect(area);
+
+    const int count = history != nullptr ? history->count.load(std::memory_order_acquire) : 0;
+    if (count == 0) {
+        painter.drawText(area, Qt::AlignCenter, "Нет данных о сходимости");
+        return;
+    }
+
+    const HistoryRecord *rec = history->records;
+    const double norm = history->rhs_norm > 0 ? history->rhs_norm : 1.0;
+
+    // По вертикали log10 относительной невязки, границы -- целые декады
+    double lo = 0, hi = -300;
+    for (int q = 0; q < count; ++q) {
+        const double value = std::log10(std::max(rec[q].residual / norm, 1e-300));
+        lo = std::min(lo, value);
+        hi = std::max(hi, value);
+    }
+    lo = std::floor(lo);
+    hi = std::max(std::ceil(hi), lo + 1);
+
+    const double sx = area.width() / std::max(count - 1, 1);
+    const double sy = area.height() / (hi - lo);
+    auto point = [&](int q) {
+        const double value = std::log10(std::max(rec[q].residual / norm, 1e-300));
+        return QPointF(area.left() + q * sx, area.bottom() - (value - lo) * sy);
+    };
+
+    painter.setPen(QPen(QColor("#D0D0E0"), 1, Qt::DashLine));
+    for (int q = 1; q < count; ++q) {
+        if (rec[q].restart != rec[q - 1].restart) {
+            painter.drawLine(QPointF(area.left() + q * sx, area.top()), QPointF(area.left() + q * sx, area.bottom()));
+        }
+    }
+
+    QPainterPath path(point(0));
+    for (int q = 1; q < count; ++q) {
+        path.lineTo(point(q));
+    }
+    painter.setPen(QPen(QColor("#003366"), 1.5));
+    painter.drawPath(path);
+
+    painter.setPen(QColor("#003366"));
+    painter.drawText(QRectF(0, area.top() - 6, 44, 14), Qt::AlignRight, QString("1e%1").arg((int)hi));
+    painter.drawText(QRectF(0, area.bottom() - 8, 44, 14), Qt::AlignRight, QString("1e%1").arg((int)lo));
+    painter.drawText(QRectF(area.left(), area.bottom() + 4, area.width(), 14), Qt::AlignLeft,
+                     QString("полуитераций: %1, перезапусков: %2, %3 с")
+                         .arg(count).arg(rec[count - 1].restart).arg(rec[count - 1].time, 0, 'f', 3));
+}
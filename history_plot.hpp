@@ -0,0 +1,27 @@
+#ifndef HISTORY_PLOT_HPP
+#define HISTORY_PLOT_HPP
+
+#include <QWidget>
+#include "history.h"
+
+// График относительной невязки ||r|| / ||b|| по полуитерациям в логарифмической
+// шкале; вертикальные линии отмечают перезапуски метода. Данные читаются
+// из History без копирования, перерисовка -- когда выросло число записей.
+class HistoryPlot : public QWidget {
+    Q_OBJECT
+
+public:
+    HistoryPlot(QWidget *parent = nullptr);
+
+    void setHistory(const History *history);
+    void refresh();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    const History *history;
+    int shown;                  // Число записей при последней перерисовке
+};
+
+#endif // HISTORY_PLOT_HPP
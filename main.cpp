@@ -1,6 +1,9 @@
 #include <string>
 #include <cstring>
+#include <cerrno>
 #include "all_includes.h"
+#include "distributed.h"
+#include "sweep.h"
 #include <fenv.h>
 #include <iostream>
 #include <stdexcept>
@@ -8,15 +11,37 @@
 
 int main(int argc, char* argv[]) {
     feenableexcept(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW);
+
+    // Серия задач из файла в одном процессе
+    if (argc >= 3 && strcmp(argv[1], "--sweep") == 0) {
+        return sweep_main(argc, argv);
+    }
     
     
-    if (argc != 11) {
-        std::cerr << "Usage: " << argv[0] << " a b c d nx ny k epsilon max_iterations threads" << std::endl;
+    if (argc < 11) {
+        std::cerr << "Usage: " << argv[0] << " a b c d nx ny k epsilon max_iterations threads"
+                  << " [--procs N] [--transport shm|socket] [--sstep S] [--arena-report] [--ooc DIR]"
+                  << " [--checkpoint FILE [--checkpoint-every N] [--resume]]"
+                  << " [--output FILE [--output-errors]] [--trace FILE] [--perf] [--history FILE]" << std::endl;
+        std::cerr << "       " << argv[0] << " --sweep LIST [--sweep-output FILE] [--sweep-format csv|json]" << std::endl;
         return 1;
     }
 
     double a, b, c, d, eps;
     int nx, ny, k, max_its, p;
+    int procs = 0;
+    int sstep = 0;
+    bool arena_stats = false;
+    const char* ooc_dir = nullptr;
+    const char* ckpt_path = nullptr;
+    int ckpt_every = 0;
+    bool resume = false;
+    const char* output_path = nullptr;
+    bool output_fields = false;
+    const char* trace_path = nullptr;
+    bool perf_counters = false;
+    const char* history_path = nullptr;
+    transport_type transport = transport_type::shm;
     
     try {
         a = std::stod(argv[1]);
@@ -29,6 +54,45 @@ int main(int argc, char* argv[]) {
         eps = std::stod(argv[8]);
         max_its = std::stoi(argv[9]);
         p = std::stoi(argv[10]);
+
+        for (int i = 11; i < argc; ++i) {
+            if (strcmp(argv[i], "--procs") == 0 && i + 1 < argc) {
+                procs = std::stoi(argv[++i]);
+            } else if (strcmp(argv[i], "--arena-report") == 0) {
+                arena_stats = true;
+            } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+                ckpt_path = argv[++i];
+            } else if (strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+                ckpt_every = std::stoi(argv[++i]);
+            } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+                output_path = argv[++i];
+            } else if (strcmp(argv[i], "--output-errors") == 0) {
+                output_fields = true;
+            } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+                trace_path = argv[++i];
+            } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+                history_path = argv[++i];
+            } else if (strcmp(argv[i], "--perf") == 0) {
+                perf_counters = true;
+            } else if (strcmp(argv[i], "--resume") == 0) {
+                resume = true;
+            } else if (strcmp(argv[i], "--ooc") == 0 && i + 1 < argc) {
+                ooc_dir = argv[++i];
+            } else if (strcmp(argv[i], "--sstep") == 0 && i + 1 < argc) {
+                sstep = std::stoi(argv[++i]);
+            } else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc) {
+                ++i;
+                if (strcmp(argv[i], "shm") == 0) {
+                    transport = transport_type::shm;
+                } else if (strcmp(argv[i], "socket") == 0) {
+                    transport = transport_type::socket;
+                } else {
+                    throw std::invalid_argument(argv[i]);
+                }
+            } else {
+                throw std::invalid_argument(argv[i]);
+            }
+        }
     } catch (const std::invalid_argument& e) {
         std::cerr << "Error: Invalid argument format. All parameters must be valid numbers." << std::endl;
         std::cerr << "Usage: " << argv[0] << " a b c d nx ny k epsilon max_iterations threads" << std::endl;
@@ -38,30 +102,195 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    const int task = 6;
+
+    Functions func;
+    func.select_f(k);
+    double (*f)(double, double) = func.f;
+
+    if (sstep < 0 || sstep > SSTEP_MAX) {
+        std::cerr << "Error: Block length of the s-step method must be between 0 and " << SSTEP_MAX << "." << std::endl;
+        return 1;
+    }
+
+    if (sstep > 0 && procs > 0) {
+        std::cerr << "Error: --sstep is not supported in distributed mode." << std::endl;
+        return 1;
+    }
+    if ((ooc_dir != nullptr || arena_stats) && procs > 0) {
+        std::cerr << "Error: --ooc and --arena-report are not supported in distributed mode." << std::endl;
+        return 1;
+    }
+    if (ckpt_path != nullptr && (procs > 0 || sstep > 0)) {
+        std::cerr << "Error: Checkpoints are supported only by the threaded minimal error method." << std::endl;
+        return 1;
+    }
+    if (history_path != nullptr && (procs > 0 || sstep > 0)) {
+        std::cerr << "Error: Convergence history is recorded only by the threaded minimal error method." << std::endl;
+        return 1;
+    }
+    if (output_path != nullptr && procs > 0) {
+        std::cerr << "Error: --output is not supported in distributed mode." << std::endl;
+        return 1;
+    }
+    if (output_fields && output_path == nullptr) {
+        std::cerr << "Error: --output-errors requires --output FILE." << std::endl;
+        return 1;
+    }
+    if ((trace_path != nullptr || perf_counters) && procs > 0) {
+        std::cerr << "Error: --trace and --perf are not supported in distributed mode." << std::endl;
+        return 1;
+    }
+#ifndef APPROX_PROFILE
+    if (trace_path != nullptr || perf_counters) {
+        std::cerr << "Error: --trace and --perf require a build with -DAPPROX_PROFILE." << std::endl;
+        return 1;
+    }
+#endif
+    if (resume && ckpt_path == nullptr) {
+        std::cerr << "Error: --resume requires --checkpoint FILE." << std::endl;
+        return 1;
+    }
+
+    if (procs > 0) {
+        if (procs > ny + 1) {
+            std::cerr << "Error: Number of processes must not exceed ny + 1." << std::endl;
+            return 1;
+        }
+
+        Args args;
+        args.a = a;
+        args.b = b;
+        args.c = c;
+        args.d = d;
+        args.eps = eps;
+        args.nx = nx;
+        args.ny = ny;
+        args.maxit = max_its;
+        args.p = procs;
+        args.k = 0;
+        args.f = f;
+
+        if (run_distributed(&args, procs, transport) != 0) {
+            std::cerr << "Error: Distributed solve failed." << std::endl;
+            free_results();
+            return 3;
+        }
+
+        printf(
+            "%s : Task = %d R1 = %e R2 = %e R3 = %e R4 = %e T1 = %.2f T2 = %.2f\n"
+            "      It = %d E = %e K = %d Nx = %d Ny = %d P = %d\n",
+            argv[0], task,
+            args.res_1, args.res_2, args.res_3, args.res_4,
+            args.t1, args.t2,
+            args.its, eps, k,
+            nx, ny, procs);
+
+        free_results();
+        return 0;
+    }
+
+    if (init_tiling(nx, ny, p)) {
+        std::cerr << "Error: Failed to allocate grid tiling." << std::endl;
+        return 2;
+    }
+
+    int n = (nx + 1) * (ny + 1);
+
+    // Матрица, векторы, базис и кольцевые буферы s-шагового метода живут в одной арене
+    Arena arena;
+    const size_t ring_length = sstep > 0 ? (size_t)p * sstep_ring_length(nx, sstep) : 0;
+    size_t basis_size = sstep > 0 ? arena_region_size((size_t)(sstep + 1) * n * sizeof(double))
+                                  + arena_region_size(ring_length * sizeof(double)) : 0;
+    size_t fields_size = output_fields ? arena_region_size((size_t)n * sizeof(double))
+                                       + arena_region_size((size_t)2 * nx * ny * sizeof(double)) : 0;
+    size_t arena_size = solver_arena_size(nx, ny, 5) + basis_size + fields_size;
+    if (ooc_dir != nullptr ? arena_reserve_file(&arena, arena_size, ooc_dir)
+                           : arena_reserve(&arena, arena_size)) {
+        std::cerr << "Error: Failed to map solver arena." << std::endl;
+        return 2;
+    }
+
+    // 64-битные индексы только когда 32-битных не хватает, иначе I вдвое компактнее
+    const bool wide = msr_needs_64bit(nx, ny);
     int* I = nullptr;
+    long long* I64 = nullptr;
     double* A = nullptr;
-    if (allocate_msr_matrix(nx, ny, &A, &I)) { 
+    double* vectors[5];
+    if (wide ? allocate_solver_buffers(&arena, nx, ny, 5, &A, &I64, vectors)
+             : allocate_solver_buffers(&arena, nx, ny, 5, &A, &I, vectors)) { 
         std::cerr << "Error: Failed to allocate MSR matrix." << std::endl;
         return 2; 
     }
     
     init_reduce_sum(p);
     
-    int n = (nx + 1) * (ny + 1);
-    
-    double* B = new double[n];
-    double* x = new double[n];
-    double* r = new double[n];
-    double* u = new double[n];
-    double* v = new double[n];
+    double* B = vectors[0];
+    double* x = vectors[1];
+    double* r = vectors[2];
+    double* u = vectors[3];
+    double* v = vectors[4];
+    double* V = sstep > 0 ? (double*)arena_alloc(&arena, (size_t)(sstep + 1) * n * sizeof(double)) : nullptr;
+    double* ring = sstep > 0 ? (double*)arena_alloc(&arena, ring_length * sizeof(double)) : nullptr;
+    double* node_errors = output_fields ? (double*)arena_alloc(&arena, (size_t)n * sizeof(double)) : nullptr;
+    double* triangle_errors = output_fields ? (double*)arena_alloc(&arena, (size_t)2 * nx * ny * sizeof(double)) : nullptr;
 
-    fill_I(nx, ny, I);
+    if (wide) {
+        fill_I(nx, ny, I64);
+    } else {
+        fill_I(nx, ny, I);
+    }
 
     memset(x, 0, n * sizeof(double));
 
-    Functions func;
-    func.select_f(k);
-    double (*f)(double, double) = func.f;
+    // Снимки делаются между перезапусками метода, по умолчанию после каждого
+    Checkpoint ckpt;
+    if (ckpt_path != nullptr) {
+        CheckpointHeader params;
+        params.nx = nx;
+        params.ny = ny;
+        params.k = k;
+        params.maxit = max_its;
+        params.a = a;
+        params.b = b;
+        params.c = c;
+        params.d = d;
+        params.eps = eps;
+        if (checkpoint_open(&ckpt, ckpt_path, ckpt_every > 0 ? ckpt_every : max_its, &params)) {
+            std::cerr << "Error: Failed to start checkpoint writer." << std::endl;
+            return 2;
+        }
+        if (resume) {
+            int res = checkpoint_load(&ckpt, x);
+            if (res == -2) {
+                std::cerr << "Error: Checkpoint " << ckpt_path << " was written for different parameters." << std::endl;
+                checkpoint_close(&ckpt);
+                return 1;
+            }
+            if (res != 0) {
+                std::cerr << "Error: Failed to read checkpoint " << ckpt_path << "." << std::endl;
+                checkpoint_close(&ckpt);
+                return 1;
+            }
+        }
+    }
+
+    if (trace_path != nullptr && trace_open(p)) {
+        std::cerr << "Error: Failed to allocate trace buffers." << std::endl;
+        return 2;
+    }
+
+    // Без доступа к PMU (виртуальная машина, perf_event_paranoid) остаются тайминги
+    if (perf_counters && profile_perf_open()) {
+        std::cerr << "Warning: Hardware counters are unavailable (" << strerror(errno)
+                  << "), reporting timings only." << std::endl;
+    }
+
+    History history;
+    if (history_path != nullptr && history_init(&history, history_capacity(max_its, SOLVER_MAXSTEPS))) {
+        std::cerr << "Error: Failed to allocate convergence history." << std::endl;
+        return 2;
+    }
 
     Args* args = new Args[p];
     pthread_t* threads = new pthread_t[p];
@@ -73,6 +302,7 @@ int main(int argc, char* argv[]) {
         args[i].d = d;
         args[i].eps = eps;
         args[i].I = I;
+        args[i].I64 = I64;
         args[i].A = A;
         args[i].B = B;
         args[i].x = x;
@@ -85,6 +315,13 @@ int main(int argc, char* argv[]) {
         args[i].p = p;
         args[i].k = i;
         args[i].f = f;
+        args[i].sstep = sstep;
+        args[i].V = V;
+        args[i].ring = ring;
+        args[i].ckpt = ckpt_path != nullptr ? &ckpt : nullptr;
+        args[i].node_errors = node_errors;
+        args[i].triangle_errors = triangle_errors;
+        args[i].history = history_path != nullptr ? &history : nullptr;
 
         pthread_create(&threads[i], nullptr, &::solution, &args[i]); 
     }
@@ -95,6 +332,7 @@ int main(int argc, char* argv[]) {
     args[0].d = d;
     args[0].eps = eps;
     args[0].I = I;
+    args[0].I64 = I64;
     args[0].A = A;
     args[0].B = B;
     args[0].x = x;
@@ -107,6 +345,13 @@ int main(int argc, char* argv[]) {
     args[0].p = p;
     args[0].k = 0;
     args[0].f = f;
+    args[0].sstep = sstep;
+    args[0].V = V;
+    args[0].ring = ring;
+    args[0].ckpt = ckpt_path != nullptr ? &ckpt : nullptr;
+    args[0].node_errors = node_errors;
+    args[0].triangle_errors = triangle_errors;
+    args[0].history = history_path != nullptr ? &history : nullptr;
     
     ::solution(&args[0]);
 
@@ -122,8 +367,6 @@ int main(int argc, char* argv[]) {
     double t1 = args[0].t1;
     double t2 = args[0].t2;
 
-    const int task = 6;
-
     printf(
         "%s : Task = %d R1 = %e R2 = %e R3 = %e R4 = %e T1 = %.2f T2 = %.2f\n"
         "      It = %d E = %e K = %d Nx = %d Ny = %d P = %d\n",
@@ -133,17 +376,67 @@ int main(int argc, char* argv[]) {
         its, eps, k, 
         nx, ny, p);
 
+    int status = 0;
+    if (output_path != nullptr) {
+        OutputHeader header;
+        memset(&header, 0, sizeof(header));
+        header.k = k;
+        header.nx = nx;
+        header.ny = ny;
+        header.its = its;
+        header.a = a;
+        header.b = b;
+        header.c = c;
+        header.d = d;
+        header.eps = eps;
+        header.res[0] = r1;
+        header.res[1] = r2;
+        header.res[2] = r3;
+        header.res[3] = r4;
+        if (output_write(output_path, &header, x, node_errors, triangle_errors)) {
+            std::cerr << "Error: Failed to write solution to " << output_path << "." << std::endl;
+            status = 2;
+        }
+    }
+
+    if (history_path != nullptr) {
+        if (history_write(&history, history_path)) {
+            std::cerr << "Error: Failed to write convergence history to " << history_path << "." << std::endl;
+            status = 2;
+        } else if (history.dropped > 0) {
+            std::cerr << "Warning: " << history.dropped << " history records did not fit in the buffer." << std::endl;
+        }
+        history_free(&history);
+    }
+
+    if (arena_stats) {
+        arena_report(&arena, stderr);
+    }
+
+    // Пусто без -DAPPROX_PROFILE
+    profile_report(stderr, p);
+    profile_perf_close();
+
+    if (trace_path != nullptr) {
+        if (trace_write(trace_path)) {
+            std::cerr << "Error: Failed to write trace to " << trace_path << "." << std::endl;
+            status = 2;
+        }
+        trace_close();
+    }
+
+    if (ckpt_path != nullptr) {
+        checkpoint_close(&ckpt);
+        if (ckpt.failed > 0) {
+            std::cerr << "Warning: " << ckpt.failed << " checkpoint writes to " << ckpt_path << " failed." << std::endl;
+        }
+    }
 
     free_results();
-    delete[] I;
-    delete[] A;
-    delete[] B;
-    delete[] x;
-    delete[] r;
-    delete[] u;
-    delete[] v;
+    free_tiling();
+    arena_release(&arena);
     delete[] args;
     delete[] threads;
 
-    return 0;
+    return status;
 }
@@ -9,28 +9,71 @@
 #include "common_types.h"
 #include <string>
 
-void matrix_mult_vector_msr(int n, double* A, int* I, double* x, double* y, int p, int k);
-int minimal_errors_msr_matrix(int n, double* A, int* I, double* b, double* x,
-    double* r, double* u, double* v, double eps, int maxit, int p, int k);
+// Ядра MSR шаблонны по типу элементов I: int для обычных сеток, long long когда
+// число ненулевых превышает INT_MAX (см. msr_needs_64bit). Номера узлов всегда int.
+template <class index_t>
+void matrix_mult_vector_msr(int n, double* A, index_t* I, double* x, double* y, int p, int k);
+template <class index_t>
+void matrix_mult_vector_msr_rows(int i1, int i2, double* A, index_t* I, double* x, double* y);
+struct Checkpoint;
+struct History;
 
-int minimal_errors_msr_matrix_full(int n, double* A, int* I, double* b, double* x, double* r, double* u, double* v, 
-    double eps, int maxit, int maxsteps, int p, int k);
+// history -- запись сходимости потоком 0, nullptr -- без неё. ckpt -- снимки
+// внутри перезапуска attempt, iterations -- итерации до его начала
+template <class index_t>
+int minimal_errors_msr_matrix(int n, double* A, index_t* I, double* b, double* x,
+    double* r, double* u, double* v, double eps, int maxit, int p, int k, History* history = nullptr,
+    Checkpoint* ckpt = nullptr, int nx = 0, int ny = 0, int attempt = 0, int iterations = 0);
+
+// nx, ny и ckpt нужны только для контрольных точек
+template <class index_t>
+int minimal_errors_msr_matrix_full(int n, double* A, index_t* I, double* b, double* x, double* r, double* u, double* v, 
+    double eps, int maxit, int maxsteps, int p, int k, int nx = 0, int ny = 0, Checkpoint* ckpt = nullptr,
+    History* history = nullptr);
+
+extern const int msr_neighbors[6][2];
 
 void ij2l(int nx, int, int i, int j, int& l);
 void l2ij(int nx, int, int& i, int& j, int l);
-int get_len_msr(int nx, int ny);
+long long get_len_msr(int nx, int ny);
+bool msr_needs_64bit(int nx, int ny);
 int get_off_diag(int nx, int ny, int i, int j, int* I_ij = nullptr);
-int get_len_msr_off_diag(int nx, int ny);
-int allocate_msr_matrix(int nx, int ny, double** p_A, int** p_I);
-void fill_I(int nx, int ny, int* I);
+long long get_len_msr_off_diag(int nx, int ny);
+template <class index_t>
+int allocate_msr_matrix(int nx, int ny, double** p_A, index_t** p_I);
+template <class index_t>
+void fill_I(int nx, int ny, index_t* I);
 void fill_A_ij(int nx, int ny, double hx, double hy, int i, int j, double* A_diag, double* A_off_diag);
-void fill_A(int nx, int ny, double hx, double hy, int* I, double* A, int p, int k);
-int check_symm(int nx, int ny, int* I, double* A, double eps, int p, int k);
+template <class index_t>
+void fill_A(int nx, int ny, double hx, double hy, index_t* I, double* A, int p, int k);
+template <class index_t>
+int check_symm(int nx, int ny, index_t* I, double* A, double eps, int p, int k);
+
+template <class index_t>
+void apply_preconditioner_msr_matrix(int n, double* A, index_t* I, double* v1, double* v2, int flag, int p, int k);
+template <class index_t>
+void solve_rsystem(int n, index_t* I, double* U, double* b, double* x, double w, int p, int k);
+template <class index_t>
+void solve_lsystem(int n, index_t* I, double* U, double* b, double* x, double w, int p, int k);
+template <class index_t>
+void solve_rsystem_rows(int i1, int i2, index_t* I, double* U, double* b, double* x, double w);
+template <class index_t>
+void solve_lsystem_rows(int i1, int i2, index_t* I, double* U, double* b, double* x, double w);
+template <class index_t>
+bool step(int n, double* A, index_t* I, double* x, double* r, double* u, double* v, double prec, int p, int k,
+    History* history = nullptr);
+
+#define SOLVER_MAXSTEPS 300 // Перезапусков метода минимальных ошибок, гиперпараметр
+#define SSTEP_MAX 8
+#define PREFETCH_ROWS 32768 // Окно упреждающего чтения вне памяти, около 3 МБ матрицы и векторов
 
-void apply_preconditioner_msr_matrix(int n, double* A, int* I, double* v1, double* v2, int flag, int p, int k);
-void solve_rsystem(int n, int* I, double* U, double* b, double* x, double w, int p, int k);
-void solve_lsystem(int n, int* I, double* U, double* b, double* x, double w, int p, int k);
-bool step(int n, double* A, int* I, double* x, double* r, double* u, double* v, double prec, int p, int k);
+template <class index_t>
+void matrix_powers_msr(int nx, int ny, double* A, index_t* I, double** V, int s, double scale,
+    double* ring, int p, int k);
+template <class index_t>
+int ca_minimal_residual_msr_matrix(int nx, int ny, double* A, index_t* I, double* b, double* x,
+    double** V, double* ring, int s, double eps, int maxit, int p, int k);
+size_t sstep_ring_length(int nx, int s);
 
 void displayVector(int vectorSize, double* dataArray);
 bool isNumber(std::string& str);
@@ -0,0 +1,163 @@
+#include "all_includes.h"
+#include <string.h>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define OUTPUT_CHUNK (64L << 20)
+
+static long long align_offset(long long offset) {
+    return (offset + OUTPUT_ALIGN - 1) / OUTPUT_ALIGN * OUTPUT_ALIGN;
+}
+
+// Поля ошибок по x в естественном порядке; x уже переведён из плиточной нумерации
+void output_errors(int nx, int ny, double a, double c, double hx, double hy, const double* x,
+    double (*f)(double, double), double* node_errors, double* triangle_errors, int p, int k) {
+    int l1, l2;
+    thread_rows((nx + 1) * (ny + 1), p, k, l1, l2);
+
+    for (int l = l1; l < l2; ++l) {
+        const int j = l / (nx + 1);
+        const int i = l - j * (nx + 1);
+
+        if (node_errors != nullptr) {
+            node_errors[l] = fabs(f(a + i * hx, c + j * hy) - x[l]);
+        }
+
+        if (triangle_errors == nullptr || i == nx || j == ny) {
+            continue;
+        }
+
+        const double node = x[l];
+        const double right = x[l + 1];
+        const double diag = x[l + nx + 2];
+        const double top = x[l + nx + 1];
+        double* t = triangle_errors + 2 * ((size_t)i + (size_t)j * nx);
+        t[0] = fabs(f(a + (i + 2.0/3.0) * hx, c + (j + 1.0/3.0) * hy) - (node + right + diag) / 3.0);
+        t[1] = fabs(f(a + (i + 1.0/3.0) * hx, c + (j + 2.0/3.0) * hy) - (node + top + diag) / 3.0);
+    }
+
+    reduce_sum<int>(p);
+}
+
+static int write_at(int fd, const void* data, size_t bytes, long long offset) {
+    const char* ptr = (const char*)data;
+    while (bytes > 0) {
+        ssize_t res = pwrite(fd, ptr, std::min(bytes, (size_t)OUTPUT_CHUNK), (off_t)offset);
+        if (res <= 0) {
+            return -1;
+        }
+        ptr += res;
+        bytes -= res;
+        offset += res;
+    }
+    return 0;
+}
+
+// Массивы пишутся напрямую из буферов решателя крупными последовательными
+// блоками, без промежуточного форматирования
+int output_write(const char* path, const OutputHeader* params, const double* x,
+    const double* node_errors, const double* triangle_errors) {
+    OutputHeader h = *params;
+    const long long n = (long long)(h.nx + 1) * (h.ny + 1);
+    const long long nt = 2LL * h.nx * h.ny;
+
+    memcpy(h.magic, OUTPUT_MAGIC, sizeof(h.magic));
+    h.flags = (node_errors ? OUTPUT_NODE_ERRORS : 0) | (triangle_errors ? OUTPUT_TRIANGLE_ERRORS : 0);
+    h.reserved = 0;
+
+    long long offset = align_offset(sizeof(OutputHeader));
+    h.x_offset = offset;
+    offset = align_offset(offset + n * (long long)sizeof(double));
+    h.node_errors_offset = node_errors ? offset : 0;
+    offset = node_errors ? align_offset(offset + n * (long long)sizeof(double)) : offset;
+    h.triangle_errors_offset = triangle_errors ? offset : 0;
+    offset = triangle_errors ? offset + nt * (long long)sizeof(double) : offset;
+    h.file_size = offset;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    bool ok = ftruncate(fd, (off_t)h.file_size) == 0
+        && write_at(fd, &h, sizeof(h), 0) == 0
+        && write_at(fd, x, n * sizeof(double), h.x_offset) == 0
+        && (!node_errors || write_at(fd, node_errors, n * sizeof(double), h.node_errors_offset) == 0)
+        && (!triangle_errors || write_at(fd, triangle_errors, nt * sizeof(double), h.triangle_errors_offset) == 0);
+
+    if (close(fd) != 0 || !ok) {
+        return -1;
+    }
+    return 0;
+}
+
+// Массив из count значений double по смещению offset целиком внутри файла
+// размера size и выровнен; offset 0 (нет массива) проверяется отдельно
+static bool array_fits(long long offset, long long count, long long size) {
+    return offset >= (long long)sizeof(OutputHeader) && offset % (long long)sizeof(double) == 0
+        && offset <= size && count <= (size - offset) / (long long)sizeof(double);
+}
+
+int output_open(const char* path, OutputFile* file) {
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(OutputHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    // Заголовку не доверяем: усечённый или испорченный файл не должен давать
+    // чтение за концом отображения, а k и область используются без проверок
+    const OutputHeader* h = (const OutputHeader*)base;
+    const long long size = st.st_size;
+    bool valid = memcmp(h->magic, OUTPUT_MAGIC, sizeof(h->magic)) == 0 && h->nx > 0 && h->ny > 0
+        && h->k >= 0 && h->k <= 7 && h->a < h->b && h->c < h->d && h->file_size == size;
+    if (valid) {
+        // Чтение индексирует узлы int, поэтому (nx + 1)(ny + 1) не больше INT_MAX;
+        // nx + 1 считается уже в long long, иначе nx = INT_MAX даёт отрицательное n
+        const long long n = ((long long)h->nx + 1) * ((long long)h->ny + 1);
+        const long long triangles = 2LL * h->nx * h->ny;
+        valid = n <= INT_MAX && array_fits(h->x_offset, n, size)
+            && (h->node_errors_offset == 0 || array_fits(h->node_errors_offset, n, size))
+            && (h->triangle_errors_offset == 0 || array_fits(h->triangle_errors_offset, triangles, size));
+    }
+    if (!valid) {
+        munmap(base, st.st_size);
+        return -2;
+    }
+
+    file->base = base;
+    file->size = st.st_size;
+    file->header = h;
+    file->x = (const double*)((const char*)base + h->x_offset);
+    if (h->node_errors_offset != 0) {
+        file->node_errors = (const double*)((const char*)base + h->node_errors_offset);
+    }
+    if (h->triangle_errors_offset != 0) {
+        file->triangle_errors = (const double*)((const char*)base + h->triangle_errors_offset);
+    }
+    return 0;
+}
+
+void output_close(OutputFile* file) {
+    if (file->base != nullptr) {
+        munmap(file->base, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
@@ -0,0 +1,56 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+#define OUTPUT_MAGIC "A2DSOL01"
+#define OUTPUT_ALIGN 64
+
+enum output_flags {
+    OUTPUT_NODE_ERRORS = 1,         // |f - x| в узлах, (nx+1)*(ny+1) значений
+    OUTPUT_TRIANGLE_ERRORS = 2      // |f - P_f| в центрах треугольников, 2*nx*ny значений
+};
+
+// Заголовок файла решения. Массивы double лежат в естественном порядке узлов
+// l = i + j*(nx+1) по смещениям, кратным OUTPUT_ALIGN, поэтому файл можно
+// отобразить через mmap и читать без копирования. Треугольники ячейки (i, j)
+// имеют номера 2*(i + j*nx) (узлы (i,j), (i+1,j), (i+1,j+1)) и следующий за ним
+// ((i,j), (i,j+1), (i+1,j+1)). Смещение 0 означает отсутствие массива.
+struct OutputHeader {
+    char magic[8];
+    int flags;
+    int k;
+    int nx;
+    int ny;
+    int its;
+    int reserved;
+    double a;
+    double b;
+    double c;
+    double d;
+    double eps;
+    double res[4];      // R1..R4
+    long long x_offset;
+    long long node_errors_offset;
+    long long triangle_errors_offset;
+    long long file_size;
+};
+
+// Отображённый файл решения
+struct OutputFile {
+    const OutputHeader* header;
+    const double* x;
+    const double* node_errors;
+    const double* triangle_errors;
+    void* base;
+    size_t size;
+};
+
+void output_errors(int nx, int ny, double a, double c, double hx, double hy, const double* x,
+    double (*f)(double, double), double* node_errors, double* triangle_errors, int p, int k);
+int output_write(const char* path, const OutputHeader* params, const double* x,
+    const double* node_errors, const double* triangle_errors);
+int output_open(const char* path, OutputFile* file);
+void output_close(OutputFile* file);
+
+#endif // OUTPUT_H
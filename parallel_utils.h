@@ -4,15 +4,18 @@
 #include <pthread.h>
 #include <stddef.h>
 #include <algorithm>
+#include "profile.h"
 
 void thread_rows(int n, int p, int k, int& i1, int& i2);
 double scalar_product(int n, double* x, double* y, int p, int k);
 void mult_sub_vector(int n, double* x, double* y, double tau, int p, int k);
 void* solution(void* ptr);
 double get_cpu_time();
+double wall_time();
 
 int init_reduce_sum(int p);
 double reduce_sum_det(int p, int k, double s);
+void reduce_sum_det_array(int p, int k, double* a, double* out, int n);
 void free_results();
 
 template<class T>
@@ -42,6 +45,7 @@ void reduce_sum(int p, T* a = nullptr, int n = 0, void (*func)(T*, T*, int) = &s
     if (p <= 1) {
         return;
     }
+    PROFILE_SCOPE(PHASE_BARRIER);
 
     pthread_mutex_lock(&m);
 
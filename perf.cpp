@@ -0,0 +1,117 @@
+#include "perf.h"
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char* counter_names[PERF_COUNT] = {
+    "cycles", "instructions", "llc_refs", "llc_misses", "br_misses"
+};
+
+const char* perf_counter_name(int counter) {
+    return counter_names[counter];
+}
+
+#ifdef __linux__
+
+static const unsigned long long counter_configs[PERF_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_event(unsigned long long config, int leader) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = leader < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+}
+
+// Лидер -- циклы; остальные события добавляются, пока PMU их принимает
+int perf_group_open(PerfGroup* group) {
+    group->opened = 0;
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        group->fd[e] = -1;
+        group->slot[e] = -1;
+    }
+
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        group->fd[e] = open_event(counter_configs[e], e == 0 ? -1 : group->fd[0]);
+        if (group->fd[e] < 0) {
+            if (e == 0) {
+                return -1;
+            }
+            continue;
+        }
+        group->slot[e] = group->opened++;
+    }
+
+    ioctl(group->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return 0;
+}
+
+// Накопленные значения с поправкой на мультиплексирование
+int perf_group_read(const PerfGroup* group, long long values[PERF_COUNT]) {
+    unsigned long long buf[3 + PERF_COUNT];
+    if (group->opened == 0 || read(group->fd[0], buf, sizeof(buf)) < (ssize_t)(3 * sizeof(buf[0]))) {
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            values[e] = -1;
+        }
+        return -1;
+    }
+
+    const double scale = buf[2] > 0 && buf[2] < buf[1] ? (double)buf[1] / buf[2] : 1.0;
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        values[e] = group->slot[e] < 0 ? -1 : (long long)(buf[3 + group->slot[e]] * scale);
+    }
+    return 0;
+}
+
+void perf_group_close(PerfGroup* group) {
+    for (int e = PERF_COUNT - 1; e >= 0; --e) {
+        if (group->fd[e] >= 0) {
+            close(group->fd[e]);
+            group->fd[e] = -1;
+        }
+    }
+    group->opened = 0;
+}
+
+#else
+
+int perf_group_open(PerfGroup* group) {
+    group->opened = 0;
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        group->fd[e] = -1;
+        group->slot[e] = -1;
+    }
+    errno = ENOSYS;
+    return -1;
+}
+
+int perf_group_read(const PerfGroup*, long long values[PERF_COUNT]) {
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        values[e] = -1;
+    }
+    return -1;
+}
+
+void perf_group_close(PerfGroup* group) {
+    group->opened = 0;
+}
+
+#endif // __linux__
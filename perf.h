@@ -0,0 +1,31 @@
+#ifndef PERF_H
+#define PERF_H
+
+// Аппаратные счётчики через perf_event_open: группа событий на поток,
+// считается только пользовательский код вызывающего потока. Если ядро или
+// PMU не дают открыть событие, оно пропускается (значение -1); если не
+// открылся лидер группы, счётчиков нет совсем и остаются только тайминги.
+
+enum perf_counter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_REFERENCES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNT
+};
+
+#define PERF_LINE_BYTES 64
+
+struct PerfGroup {
+    int fd[PERF_COUNT];
+    int slot[PERF_COUNT];   // Позиция события в ответе read(), -1 если не открыто
+    int opened;
+};
+
+int perf_group_open(PerfGroup* group);
+int perf_group_read(const PerfGroup* group, long long values[PERF_COUNT]);
+void perf_group_close(PerfGroup* group);
+const char* perf_counter_name(int counter);
+
+#endif // PERF_H
@@ -0,0 +1,225 @@
+#include "profile.h"
+#include "trace.h"
+#include "perf.h"
+
+#ifdef APPROX_PROFILE
+
+#include <time.h>
+#include <string.h>
+#include <algorithm>
+
+#define PROFILE_DEPTH 16
+
+// Счётчики потока занимают отдельные строки кэша
+struct alignas(64) ProfileCounters {
+    double seconds[PHASE_COUNT];
+    long long calls[PHASE_COUNT];
+    long long events[PHASE_COUNT][PERF_COUNT];
+};
+
+static ProfileCounters counters[PROFILE_MAX_THREADS];
+
+static const char* phase_names[PHASE_COUNT] = {
+    "matvec", "precond", "dot", "axpy", "barrier", "fill_A", "fill_B", "residual"
+};
+
+static thread_local ProfileCounters* local = &counters[0];
+static thread_local profile_phase stack[PROFILE_DEPTH];
+static thread_local double started[PROFILE_DEPTH];
+static thread_local int depth = 0;
+static thread_local double mark = 0;
+
+// Группы счётчиков открываются в profile_thread, если их включил profile_perf_open
+static bool perf_enabled = false;
+static bool perf_present[PERF_COUNT];
+static PerfGroup groups[PROFILE_MAX_THREADS];
+static thread_local PerfGroup* group = nullptr;
+static thread_local long long perf_mark[PERF_COUNT];
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Время и события с последней отметки относятся к фазе на вершине стека
+static void account(double t) {
+    long long values[PERF_COUNT];
+    if (group != nullptr) {
+        perf_group_read(group, values);
+    }
+    if (depth > 0) {
+        const int ph = stack[std::min(depth, PROFILE_DEPTH) - 1];
+        local->seconds[ph] += t - mark;
+        if (group != nullptr) {
+            for (int e = 0; e < PERF_COUNT; ++e) {
+                if (values[e] >= 0) {
+                    local->events[ph][e] += values[e] - perf_mark[e];
+                }
+            }
+        }
+    }
+    mark = t;
+    if (group != nullptr) {
+        memcpy(perf_mark, values, sizeof(perf_mark));
+    }
+}
+
+// Группа открывается заново: в серии задач поток с номером k может смениться
+void profile_thread(int k) {
+    local = &counters[k % PROFILE_MAX_THREADS];
+    depth = 0;
+    trace_thread(k);
+
+    group = nullptr;
+    if (perf_enabled) {
+        PerfGroup* g = &groups[k % PROFILE_MAX_THREADS];
+        if (g->opened > 0) {
+            perf_group_close(g);
+        }
+        if (perf_group_open(g) == 0) {
+            group = g;
+            perf_group_read(group, perf_mark);
+        }
+    }
+}
+
+// Пробная группа в вызывающем потоке показывает, какие события доступны
+int profile_perf_open() {
+    PerfGroup probe;
+    if (perf_group_open(&probe)) {
+        return -1;
+    }
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        perf_present[e] = probe.slot[e] >= 0;
+    }
+    perf_group_close(&probe);
+    perf_enabled = true;
+    return 0;
+}
+
+void profile_perf_close() {
+    for (int k = 0; k < PROFILE_MAX_THREADS; ++k) {
+        if (groups[k].opened > 0) {
+            perf_group_close(&groups[k]);
+        }
+    }
+    perf_enabled = false;
+}
+
+void profile_enter(profile_phase phase) {
+    const double t = now();
+    account(t);
+    if (depth < PROFILE_DEPTH) {
+        stack[depth] = phase;
+        started[depth] = t;
+    }
+    depth++;
+    local->calls[phase]++;
+}
+
+// На трассу идёт полное (не исключающее) время фазы
+void profile_leave() {
+    const double t = now();
+    account(t);
+    depth--;
+    if (depth < PROFILE_DEPTH && trace_enabled()) {
+        trace_record(stack[depth], started[depth], t);
+    }
+}
+
+const char* profile_phase_name(profile_phase phase) {
+    return phase_names[phase];
+}
+
+void profile_reset() {
+    memset(counters, 0, sizeof(counters));
+}
+
+// Суммы событий по всем потокам; LLC MB -- промахи последнего уровня,
+// умноженные на длину строки, то есть оценка трафика с памятью
+static void profile_report_events(FILE* out, int p) {
+    fprintf(out, "Hardware counters (sum over threads):\n%-8s", "phase");
+    for (int e = 0; e < PERF_COUNT; ++e) {
+        fprintf(out, " %14s", perf_counter_name(e));
+    }
+    fprintf(out, " %6s %10s\n", "IPC", "LLC MB");
+
+    for (int ph = 0; ph < PHASE_COUNT; ++ph) {
+        long long sum[PERF_COUNT] = {0};
+        for (int k = 0; k < p; ++k) {
+            for (int e = 0; e < PERF_COUNT; ++e) {
+                sum[e] += counters[k].events[ph][e];
+            }
+        }
+
+        fprintf(out, "%-8s", phase_names[ph]);
+        for (int e = 0; e < PERF_COUNT; ++e) {
+            if (perf_present[e]) {
+                fprintf(out, " %14lld", sum[e]);
+            } else {
+                fprintf(out, " %14s", "-");
+            }
+        }
+        if (perf_present[PERF_INSTRUCTIONS] && sum[PERF_CYCLES] > 0) {
+            fprintf(out, " %6.2f", (double)sum[PERF_INSTRUCTIONS] / sum[PERF_CYCLES]);
+        } else {
+            fprintf(out, " %6s", "-");
+        }
+        if (perf_present[PERF_LLC_MISSES]) {
+            fprintf(out, " %10.1f\n", sum[PERF_LLC_MISSES] * (double)PERF_LINE_BYTES * 1e-6);
+        } else {
+            fprintf(out, " %10s\n", "-");
+        }
+    }
+}
+
+// Таблица по потокам и отношение max/mean по каждой фазе; для барьеров
+// большое ожидание у одних потоков означает долгую работу у других
+void profile_report(FILE* out, int p) {
+    p = std::min(p, PROFILE_MAX_THREADS);
+    double total[PHASE_COUNT] = {0};
+    double peak[PHASE_COUNT] = {0};
+    double busy_max = 0, busy_sum = 0;
+
+    fprintf(out, "Profile (wall ms per thread):\n%6s", "thread");
+    for (int ph = 0; ph < PHASE_COUNT; ++ph) {
+        fprintf(out, " %10s", phase_names[ph]);
+    }
+    fprintf(out, " %10s\n", "busy");
+
+    for (int k = 0; k < p; ++k) {
+        double busy = 0;
+        fprintf(out, "%6d", k);
+        for (int ph = 0; ph < PHASE_COUNT; ++ph) {
+            const double s = counters[k].seconds[ph];
+            fprintf(out, " %10.3f", s * 1e3);
+            total[ph] += s;
+            peak[ph] = std::max(peak[ph], s);
+            if (ph != PHASE_BARRIER) {
+                busy += s;
+            }
+        }
+        fprintf(out, " %10.3f\n", busy * 1e3);
+        busy_sum += busy;
+        busy_max = std::max(busy_max, busy);
+    }
+
+    fprintf(out, "%6s", "max/mn");
+    for (int ph = 0; ph < PHASE_COUNT; ++ph) {
+        fprintf(out, " %10.3f", total[ph] > 0 ? peak[ph] * p / total[ph] : 1.0);
+    }
+    fprintf(out, " %10.3f\n", busy_sum > 0 ? busy_max * p / busy_sum : 1.0);
+
+    fprintf(out, "%6s", "calls");
+    for (int ph = 0; ph < PHASE_COUNT; ++ph) {
+        fprintf(out, " %10lld", counters[0].calls[ph]);
+    }
+    fprintf(out, "\nImbalance (max/mean busy time): %.3f\n", busy_sum > 0 ? busy_max * p / busy_sum : 1.0);
+
+    if (perf_enabled) {
+        profile_report_events(out, p);
+    }
+}
+
+#endif // APPROX_PROFILE
@@ -0,0 +1,61 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+
+// Профилирование фаз решателя по потокам, включается при сборке с -DAPPROX_PROFILE.
+// Время фаз исключающее: вложенная фаза (например, барьер внутри скалярного
+// произведения) приостанавливает внешнюю, поэтому фазы не пересекаются.
+// Время измеряется по CLOCK_MONOTONIC (vDSO, без системного вызова).
+
+enum profile_phase {
+    PHASE_MATVEC,
+    PHASE_PRECOND,
+    PHASE_DOT,
+    PHASE_AXPY,
+    PHASE_BARRIER,
+    PHASE_FILL_A,
+    PHASE_FILL_B,
+    PHASE_RESIDUAL,
+    PHASE_COUNT
+};
+
+#ifdef APPROX_PROFILE
+
+#define PROFILE_MAX_THREADS 256
+
+void profile_thread(int k);
+void profile_enter(profile_phase phase);
+void profile_leave();
+void profile_reset();
+void profile_report(FILE* out, int p);
+const char* profile_phase_name(profile_phase phase);
+int profile_perf_open();
+void profile_perf_close();
+
+struct ProfileScope {
+    explicit ProfileScope(profile_phase phase) {
+        profile_enter(phase);
+    }
+    ~ProfileScope() {
+        profile_leave();
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(phase)
+
+#else
+
+inline void profile_thread(int) {}
+inline void profile_reset() {}
+inline void profile_report(FILE*, int) {}
+inline int profile_perf_open() { return -1; }
+inline void profile_perf_close() {}
+
+#define PROFILE_SCOPE(phase) do { } while (0)
+
+#endif // APPROX_PROFILE
+
+#endif // PROFILE_H
@@ -0,0 +1,129 @@
+#include "pyramid.h"
+#include <algorithm>
+#include <new>
+
+struct PyramidStep {
+    const PyramidLevel* src;
+    double* min;
+    double* max;
+    double* mean;
+    int width;
+};
+
+// Строки [j1, j2) следующего уровня; на нечётной границе блок неполный
+static void reduce_rows(void* ptr, int j1, int j2) {
+    PyramidStep* s = (PyramidStep*)ptr;
+    const PyramidLevel* src = s->src;
+
+    for (int j = j1; j < j2; ++j) {
+        const int y0 = 2 * j;
+        const int y1 = std::min(y0 + 1, src->height - 1);
+        for (int i = 0; i < s->width; ++i) {
+            const int x0 = 2 * i;
+            const int x1 = std::min(x0 + 1, src->width - 1);
+            const int l00 = y0 * src->width + x0, l10 = y0 * src->width + x1;
+            const int l01 = y1 * src->width + x0, l11 = y1 * src->width + x1;
+
+            const int l = j * s->width + i;
+            s->min[l] = std::min(std::min(src->min[l00], src->min[l10]), std::min(src->min[l01], src->min[l11]));
+            s->max[l] = std::max(std::max(src->max[l00], src->max[l10]), std::max(src->max[l01], src->max[l11]));
+            s->mean[l] = 0.25 * (src->mean[l00] + src->mean[l10] + src->mean[l01] + src->mean[l11]);
+        }
+    }
+}
+
+// Уровни строятся один из другого до размера 1 x 1; память уровней
+// переиспользуется, пока хватает её размера
+int pyramid_build(Pyramid* pyramid, const double* values, int width, int height, StealPool* pool) {
+    pyramid->levels = 0;
+    if (values == nullptr || width < 1 || height < 1) {
+        return -1;
+    }
+
+    PyramidLevel* top = &pyramid->level[0];
+    top->width = width;
+    top->height = height;
+    top->min = top->max = top->mean = values;
+    pyramid->levels = 1;
+
+    while ((top->width > 1 || top->height > 1) && pyramid->levels < PYRAMID_MAX_LEVELS) {
+        const int L = pyramid->levels;
+        const int w = (top->width + 1) / 2;
+        const int h = (top->height + 1) / 2;
+        const size_t size = (size_t)w * h;
+
+        if (pyramid->capacity[L] < size) {
+            delete[] pyramid->storage[L];
+            pyramid->storage[L] = new (std::nothrow) double[3 * size];
+            pyramid->capacity[L] = pyramid->storage[L] != nullptr ? size : 0;
+            if (pyramid->storage[L] == nullptr) {
+                return -1;
+            }
+        }
+
+        PyramidStep step = {top, pyramid->storage[L], pyramid->storage[L] + size,
+                            pyramid->storage[L] + 2 * size, w};
+        steal_pool_for(pool, h, reduce_rows, &step);
+
+        PyramidLevel* next = &pyramid->level[L];
+        next->width = w;
+        next->height = h;
+        next->min = step.min;
+        next->max = step.max;
+        next->mean = step.mean;
+        pyramid->levels++;
+        top = next;
+    }
+
+    return 0;
+}
+
+void pyramid_free(Pyramid* pyramid) {
+    for (int L = 0; L < PYRAMID_MAX_LEVELS; ++L) {
+        delete[] pyramid->storage[L];
+        pyramid->storage[L] = nullptr;
+        pyramid->capacity[L] = 0;
+    }
+    pyramid->levels = 0;
+}
+
+// Самый грубый уровень, блок которого (2^L элементов) не длиннее шага выборки
+int pyramid_level(const Pyramid* pyramid, double step) {
+    int L = 0;
+    while (L + 1 < pyramid->levels && (double)(2 << L) <= step) {
+        L++;
+    }
+    return L;
+}
+
+// Билинейная интерполяция средних уровня level; (u, v) -- координаты в
+// элементах уровня 0, центр блока уровня L лежит в (2^L - 1) / 2 от его начала
+double pyramid_mean(const Pyramid* pyramid, int level, double u, double v) {
+    const PyramidLevel* lv = &pyramid->level[level];
+    const double scale = (double)(1 << level);
+    double x = (u - 0.5 * (scale - 1)) / scale;
+    double y = (v - 0.5 * (scale - 1)) / scale;
+
+    x = std::min(std::max(x, 0.0), (double)(lv->width - 1));
+    y = std::min(std::max(y, 0.0), (double)(lv->height - 1));
+
+    int x0 = std::min((int)x, std::max(lv->width - 2, 0));
+    int y0 = std::min((int)y, std::max(lv->height - 2, 0));
+    const int x1 = std::min(x0 + 1, lv->width - 1);
+    const int y1 = std::min(y0 + 1, lv->height - 1);
+    const double fx = x - x0;
+    const double fy = y - y0;
+
+    const double* m = lv->mean;
+    const double v0 = m[y0 * lv->width + x0] * (1 - fx) + m[y0 * lv->width + x1] * fx;
+    const double v1 = m[y1 * lv->width + x0] * (1 - fx) + m[y1 * lv->width + x1] * fx;
+    return v0 * (1 - fy) + v1 * fy;
+}
+
+// Максимум по блоку уровня level, содержащему элемент (i, j) уровня 0
+double pyramid_max(const Pyramid* pyramid, int level, int i, int j) {
+    const PyramidLevel* lv = &pyramid->level[level];
+    const int x = std::min(i >> level, lv->width - 1);
+    const int y = std::min(j >> level, lv->height - 1);
+    return lv->max[y * lv->width + x];
+}
@@ -0,0 +1,35 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include "steal.h"
+
+// Пирамида уменьшенных копий поля (решения x или погрешности по ячейкам):
+// элемент уровня L + 1 -- блок 2 x 2 уровня L, для него хранятся минимум,
+// максимум и среднее. Уровень 0 -- само поле, без копирования. При отдалении
+// renderer берёт уровень, шаг которого соответствует шагу выборки, поэтому
+// стоимость кадра не растёт с сеткой, а узкие экстремумы не теряются.
+#define PYRAMID_MAX_LEVELS 32
+
+struct PyramidLevel {
+    int width;
+    int height;
+    const double* min;      // width * height, построчно
+    const double* max;
+    const double* mean;
+};
+
+struct Pyramid {
+    int levels = 0;
+    PyramidLevel level[PYRAMID_MAX_LEVELS];
+    double* storage[PYRAMID_MAX_LEVELS] = {};   // min, max, mean уровня подряд; 0 -- nullptr
+    size_t capacity[PYRAMID_MAX_LEVELS] = {};
+};
+
+int pyramid_build(Pyramid* pyramid, const double* values, int width, int height, StealPool* pool);
+void pyramid_free(Pyramid* pyramid);
+
+int pyramid_level(const Pyramid* pyramid, double step);
+double pyramid_mean(const Pyramid* pyramid, int level, double u, double v);
+double pyramid_max(const Pyramid* pyramid, int level, int i, int j);
+
+#endif // PYRAMID_H
@@ -0,0 +1,127 @@
+#include "raster.h"
+
+// Линейная интерполяция между опорными точками, как при выборке из QLinearGradient
+unsigned int ramp_color(const ColorRamp* ramp, double value, double min, double max) {
+    double t;
+    if (max - min < 1e-16 && min - max < 1e-16) {
+        t = ramp->flat;
+    } else {
+        t = (value - min) / (max - min);
+    }
+    if (!(t >= 0)) {
+        t = 0;  // В том числе NaN
+    }
+    if (t > 1) {
+        t = 1;
+    }
+
+    for (int s = 0; s + 1 < ramp->count; ++s) {
+        const double pos1 = ramp->pos[s];
+        const double pos2 = ramp->pos[s + 1];
+        if (t >= pos1 && t <= pos2) {
+            const double w = (t - pos1) / (pos2 - pos1);
+            unsigned int color = 0xFF000000u;
+            for (int shift = 0; shift <= 16; shift += 8) {
+                const int c1 = (ramp->rgb[s] >> shift) & 0xFF;
+                const int c2 = (ramp->rgb[s + 1] >> shift) & 0xFF;
+                color |= (unsigned int)(int)(c1 + w * (c2 - c1)) << shift;
+            }
+            return color;
+        }
+    }
+
+    return 0xFF000000u;
+}
+
+// Номер ячейки по координате центра пикселя; -1, если пиксель вне сетки
+static int cell_index(double x, double left, double width, int n) {
+    if (n < 2 || width <= 0) {
+        return -1;
+    }
+    const double rel = (x - left) / width * (n - 1);
+    if (!(rel >= 0) || rel > n - 1) {
+        return -1;
+    }
+    const int i = (int)rel;
+    return i < n - 2 ? i : n - 2;
+}
+
+void bake_lut(const ColorRamp* ramp, ColorLut* lut) {
+    for (int e = 0; e < RASTER_LUT_SIZE; ++e) {
+        lut->argb[e] = ramp_color(ramp, (double)e / (RASTER_LUT_SIZE - 1), 0, 1);
+    }
+    lut->flat = ramp->flat;
+}
+
+// Поле без разброса целиком попадает в элемент flat
+LutScale lut_scale(const ColorLut* lut, double min, double max) {
+    LutScale s;
+    s.min = min;
+    if (max - min < 1e-16 && min - max < 1e-16) {
+        s.scale = 0;
+        s.offset = lut->flat * (RASTER_LUT_SIZE - 1);
+    } else {
+        s.scale = (RASTER_LUT_SIZE - 1) / (max - min);
+        s.offset = 0;
+    }
+    return s;
+}
+
+// Столбцы ячеек общие для всех строк, считаются один раз до раздачи строк;
+// пиксели вне сетки ссылаются на элемент фона nx - 1 в цветах строки
+void raster_columns(Raster* raster) {
+    const RasterGrid* grid = raster->grid;
+    for (int px = 0; px < raster->width; ++px) {
+        const double x = raster->left + (px + 0.5) * raster->view_width / raster->width;
+        const int i = cell_index(x, grid->left, grid->width, grid->nx);
+        raster->columns[px] = i < 0 ? std::max(grid->nx - 1, 0) : i;
+    }
+}
+
+// Строк ячеек ny - 1, в каждой nx - 1 ячеек и фон
+long long raster_color_count(const RasterGrid* grid) {
+    return (long long)std::max(grid->ny - 1, 0) * std::max(grid->nx, 1);
+}
+
+// Цвета ячеек строк сетки [j1, j2): проход без ветвлений по непрерывному
+// массиву. Буфер заполняет вызывающий, поэтому потокам не нужна своя память
+void raster_colors(const Raster* raster, int j1, int j2) {
+    const RasterGrid* grid = raster->grid;
+    const unsigned int* argb = raster->lut->argb;
+    const LutScale scale = lut_scale(raster->lut, grid->min, grid->max);
+    const int cells = std::max(grid->nx - 1, 0);
+
+    for (int j = j1; j < j2; ++j) {
+        const double* row = grid->values + (long long)j * grid->nx;
+        unsigned int* colors = raster->colors + (long long)j * (cells + 1);
+        for (int i = 0; i < cells; ++i) {
+            colors[i] = argb[lut_index(scale, row[i])];
+        }
+        colors[cells] = raster->background;
+    }
+}
+
+// Строки [y1, y2) изображения: пиксели -- выборка по columns из цветов строки
+// ячеек, посчитанных raster_colors
+void raster_rows(const Raster* raster, int y1, int y2) {
+    const RasterGrid* grid = raster->grid;
+    const int cells = std::max(grid->nx - 1, 0);
+
+    for (int py = y1; py < y2; ++py) {
+        unsigned int* line = raster->pixels + (long long)py * raster->stride;
+        const double y = raster->top + (raster->height - py - 0.5) * raster->view_height / raster->height;
+        const int j = cell_index(y, grid->top, grid->height, grid->ny);
+
+        if (j < 0) {
+            for (int px = 0; px < raster->width; ++px) {
+                line[px] = raster->background;
+            }
+            continue;
+        }
+
+        const unsigned int* colors = raster->colors + (long long)j * (cells + 1);
+        for (int px = 0; px < raster->width; ++px) {
+            line[px] = colors[raster->columns[px]];
+        }
+    }
+}
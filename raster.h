@@ -0,0 +1,87 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+// Растеризация поля значений прямо в буфер пикселей 0xAARRGGBB (формат
+// QImage::Format_RGB32) без QPainter. Каждый пиксель берёт цвет ячейки сетки
+// визуализации, в которую попадает его центр, поэтому время перерисовки
+// зависит от числа пикселей, а не от числа ячеек. Сначала строки ячеек
+// переводятся в цвета (raster_colors), затем строки изображения выбирают из
+// них по столбцам (raster_rows); строки обоих проходов независимы и
+// раздаются потокам кусками любого размера.
+#define RASTER_MAX_STOPS 8
+
+// Градиент заранее запекается в таблицу упакованных цветов; значение
+// переводится в номер элемента без ветвлений
+#define RASTER_LUT_SIZE 4096
+
+#include <algorithm>
+
+// Опорные точки градиента; flat -- положение на шкале для поля без разброса
+struct ColorRamp {
+    int count;
+    double pos[RASTER_MAX_STOPS];
+    unsigned int rgb[RASTER_MAX_STOPS];
+    double flat;
+};
+
+struct ColorLut {
+    unsigned int argb[RASTER_LUT_SIZE];
+    double flat;
+};
+
+// Линейное преобразование value -> позиция в таблице, общее для всего кадра
+struct LutScale {
+    double min;
+    double scale;
+    double offset;
+};
+
+// NaN и значения ниже min дают элемент 0, выше max -- последний
+inline int lut_index(const LutScale& s, double value) {
+    double t = (value - s.min) * s.scale + s.offset;
+    t = t > 0 ? t : 0;
+    t = t < RASTER_LUT_SIZE - 1 ? t : RASTER_LUT_SIZE - 1;
+    return (int)(t + 0.5);
+}
+
+// Значения в узлах сетки nx x ny, построчно: values[j * nx + i].
+// Ячейка (i, j) -- прямоугольник между узлами (i, j) и (i + 1, j + 1) в
+// логической области [left, left + width] x [top, top + height].
+struct RasterGrid {
+    const double* values;
+    int nx;
+    int ny;
+    double min;
+    double max;
+    double left;
+    double top;
+    double width;
+    double height;
+};
+
+// Изображение и видимая часть логической области; ось y направлена вверх
+struct Raster {
+    const RasterGrid* grid;
+    const ColorLut* lut;
+    unsigned int* pixels;
+    int stride;             // Длина строки в пикселях
+    int width;
+    int height;
+    double left;
+    double top;
+    double view_width;
+    double view_height;
+    unsigned int background;
+    int* columns;           // width номеров столбцов ячеек, nx - 1 -- вне сетки
+    unsigned int* colors;   // raster_color_count() цветов: по nx на строку ячеек, nx - 1 -- фон
+};
+
+unsigned int ramp_color(const ColorRamp* ramp, double value, double min, double max);
+void bake_lut(const ColorRamp* ramp, ColorLut* lut);
+LutScale lut_scale(const ColorLut* lut, double min, double max);
+void raster_columns(Raster* raster);
+long long raster_color_count(const RasterGrid* grid);
+void raster_colors(const Raster* raster, int j1, int j2);
+void raster_rows(const Raster* raster, int y1, int y2);
+
+#endif // RASTER_H
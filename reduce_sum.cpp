@@ -1,12 +1,14 @@
 #include "all_includes.h"
 
 static double* results = nullptr;
+static double** partials = nullptr;
 static pthread_mutex_t results_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 int init_reduce_sum(int p) {
     pthread_mutex_lock(&results_mutex);
     if (results == nullptr) {
         results = new double[p];
+        partials = new double*[p];
         if (results == nullptr) {
             pthread_mutex_unlock(&results_mutex);
             return -1;
@@ -35,9 +37,31 @@ double reduce_sum_det(int p, int k, double s) {
     return sum;
 }
 
+// Детерминированная сумма массивов длины n: каждый поток складывает частичные
+// массивы в порядке номеров потоков в свой out (out не должен совпадать с a)
+void reduce_sum_det_array(int p, int k, double* a, double* out, int n) {
+    int l, i;
+    partials[k] = a;
+
+    reduce_sum<int>(p);
+
+    for (i = 0; i < n; ++i) {
+        out[i] = 0;
+    }
+    for (l = 0; l < p; ++l) {
+        for (i = 0; i < n; ++i) {
+            out[i] += partials[l][i];
+        }
+    }
+
+    reduce_sum<int>(p);
+}
+
 void free_results() {
     pthread_mutex_lock(&results_mutex);
     delete[] results;
+    delete[] partials;
     results = nullptr;
+    partials = nullptr;
     pthread_mutex_unlock(&results_mutex);
 }
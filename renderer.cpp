@@ -7,6 +7,54 @@
 #include <QPainterPath>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <sys/sysinfo.h>
+#include "samples.h"
+
+static void raster_chunk(void *ptr, int y1, int y2) {
+    raster_rows((const Raster *)ptr, y1, y2);
+}
+
+static void color_chunk(void *ptr, int j1, int j2) {
+    raster_colors((const Raster *)ptr, j1, j2);
+}
+
+// Полоса строк общей выборки, начиная с first
+struct Band {
+    void (*fn)(void *, int, int);
+    void *ctx;
+    int first;
+};
+
+static void band_rows(void *ptr, int j1, int j2) {
+    Band *band = (Band *)ptr;
+    band->fn(band->ctx, band->first + j1, band->first + j2);
+}
+
+// Решётка прохода pass (0 -- самый грубый) при cells ячейках в последнем
+static int pass_cells(int cells, int pass) {
+    return std::max(cells >> (TILE_PASSES - 1 - pass), 1);
+}
+
+static bool same_range(const ColorRange &x, const ColorRange &y) {
+    const FieldRange &a = x.field;
+    const FieldRange &b = y.field;
+    return a.pseudo == b.pseudo && a.constOne == b.constOne
+        && !(a.min < b.min) && !(a.min > b.min) && !(a.max < b.max) && !(a.max > b.max);
+}
+
+// Градиент Qt запекается в таблицу цветов, которую читают потоки растеризации
+static void make_lut(const QLinearGradient &gradient, double flat, ColorLut *lut) {
+    QGradientStops stops = gradient.stops();
+    ColorRamp ramp;
+    ramp.count = std::min(stops.size(), RASTER_MAX_STOPS);
+    for (int s = 0; s < ramp.count; s++) {
+        ramp.pos[s] = stops[s].first;
+        ramp.rgb[s] = stops[s].second.rgb();
+    }
+    ramp.flat = flat;
+    bake_lut(&ramp, lut);
+}
 
 Renderer::Renderer(QWidget *parent)
     : QWidget(parent),
@@ -22,8 +70,20 @@ Renderer::Renderer(QWidget *parent)
       c(-1.0),
       d(1.0),
       zoomFactor(1.0),
+      viewCenter(0.0, 0.0),
+      dragging(false),
       mode(what_to_paint::function),
-      func(nullptr) {
+      func(nullptr),
+      dataVersion(0),
+      residualField(nullptr),
+      residualWidth(0),
+      residualHeight(0),
+      residualMax(0.0),
+      residualVersion(0),
+      tileGeneration(0),
+      tileClock(0),
+      tileBusy(false),
+      tileStop(false) {
     
     // Set background color
     setAutoFillBackground(true);
@@ -36,47 +96,64 @@ Renderer::Renderer(QWidget *parent)
     
     // Initialize visible rect
     updateVisibleRect();
+    
+    // Без дополнительных потоков пул выполняет выборки в вызывающем
+    steal_pool_init(&pool, get_nprocs());
+    
+    // Фоновый поток плиток со своим пулом: пул принимает одного вызывающего
+    for (int m = 0; m < 3; m++) {
+        ranges[m].ready = false;
+        ranges[m].exact = false;
+        ranges[m].stamp = 0;
+    }
+    tileCurrent.level = -1;
+    scene.generation = 0;
+    steal_pool_init(&tilePool, get_nprocs());
+    pthread_mutex_init(&tileMutex, nullptr);
+    pthread_cond_init(&tileWake, nullptr);
+    pthread_cond_init(&tileIdle, nullptr);
+    resizeTileCache();
+    pthread_create(&tileThread, nullptr, tileWorker, this);
 }
 
-void Renderer::setData(double *data, int width, int height) {
+Renderer::~Renderer() {
+    pthread_mutex_lock(&tileMutex);
+    tileStop = true;
+    pthread_cond_signal(&tileWake);
+    pthread_mutex_unlock(&tileMutex);
+    pthread_join(tileThread, nullptr);
+    
+    pthread_cond_destroy(&tileIdle);
+    pthread_cond_destroy(&tileWake);
+    pthread_mutex_destroy(&tileMutex);
+    steal_pool_free(&tilePool);
+    
+    pyramid_free(&dataPyramid);
+    pyramid_free(&residualPyramid);
+    steal_pool_free(&pool);
+}
+
+// Таймер окна вызывает setData каждые 50 мс; пока данные прежние (тот же
+// буфер, размер и версия), ничего не пересчитывается и не перерисовывается.
+// data == nullptr отпускает буферы окна до их перевыделения
+void Renderer::setData(double *data, int width, int height, unsigned long long version) {
+    if (data == this->data && width == dataWidth && height == dataHeight && version == dataVersion) {
+        return;
+    }
+    
+    resetTiles();
     this->data = data;
     this->dataWidth = width;
     this->dataHeight = height;
+    this->dataVersion = version;
+    
+    // Пирамида данных для отдалённых кадров
+    pyramid_build(&dataPyramid, data, width, height, &pool);
     
     // Update maxValue based on the current mode
     if (mode == what_to_paint::residual && func != nullptr) {
         // Recalculate residual immediately
-        double hx = (b - a) / (dataWidth - 1);
-        double hy = (d - c) / (dataHeight - 1);
-        double maxResidual = 0.0;
-        
-        for (int i = 0; i < dataWidth - 1; i++) {
-            for (int j = 0; j < dataHeight - 1; j++) {
-                // Get node values
-                double node1 = data[j * dataWidth + i];
-                double node2 = data[j * dataWidth + i + 1];
-                double node3 = data[(j + 1) * dataWidth + i + 1];
-                double node4 = data[(j + 1) * dataWidth + i];
-                
-                // Lower triangle point
-                double x_low = a + hx * (i + 2.0/3.0);
-                double y_low = c + hy * (j + 1.0/3.0);
-                double exact_low = func(x_low, y_low);
-                double approx_low = (node1 + node2 + node3) / 3.0;
-                double residual_low = std::fabs(exact_low - approx_low);
-                
-                // Upper triangle point
-                double x_up = a + hx * (i + 1.0/3.0);
-                double y_up = c + hy * (j + 2.0/3.0);
-                double exact_up = func(x_up, y_up);
-                double approx_up = (node1 + node3 + node4) / 3.0;
-                double residual_up = std::fabs(exact_up - approx_up);
-                
-                maxResidual = std::max(maxResidual, std::max(residual_low, residual_up));
-            }
-        }
-        
-        maxValue = maxResidual;
+        calculateMaxResidual();
     } else {
         calculateMaxValue();
     }
@@ -85,17 +162,26 @@ void Renderer::setData(double *data, int width, int height) {
 }
 
 void Renderer::setBoundaries(double a, double b, double c, double d) {
+    resetTiles();
     this->a = a;
     this->b = b;
     this->c = c;
     this->d = d;
+    viewCenter = QPointF((a + b) / 2.0, (c + d) / 2.0);
+    updateVisibleRect();
+    update();
+}
+
+// Масштаб меняется вокруг текущего центра вида; плитки не пересчитываются
+void Renderer::setZoom(double factor) {
+    zoomFactor = std::min(std::max(factor, 1.0), ZOOM_MAX);
     updateVisibleRect();
     update();
 }
 
-void Renderer::setZoom(double factor, QPointF center) {
-    zoomFactor = factor;
-    zoomCenter = center.isNull() ? QPointF(width() / 2, height() / 2) : center;
+void Renderer::resetView() {
+    zoomFactor = 1.0;
+    viewCenter = QPointF((a + b) / 2.0, (c + d) / 2.0);
     updateVisibleRect();
     update();
 }
@@ -103,28 +189,45 @@ void Renderer::setZoom(double factor, QPointF center) {
 void Renderer::setRenderMode(what_to_paint mode) {
     this->mode = mode;
     
-    // For non-residual modes, recalculate the maxValue normally
-    if (mode != what_to_paint::residual && data && dataWidth > 0 && dataHeight > 0) {
-        calculateMaxValue();
+    // Максимум сразу соответствует новому режиму, данные при этом не меняются
+    if (data && dataWidth > 0 && dataHeight > 0) {
+        if (mode == what_to_paint::residual && func != nullptr) {
+            calculateMaxResidual();
+        } else if (mode != what_to_paint::residual) {
+            calculateMaxValue();
+        }
     }
     
     update();
 }
 
 void Renderer::setFunction(double (*f)(double, double)) {
+    resetTiles();
     func = f;
     update();
 }
 
 void Renderer::setApproximation(double *approx, int width, int height) {
+    resetTiles();
     approximation = approx;
     dataWidth = width;
     dataHeight = height;
     update();
 }
 
+// В режиме функции максимум считает фоновый поток вместе со шкалой цветов
 double Renderer::getMaxValue() const {
-    return maxValue;
+    double max = maxValue;
+    pthread_mutex_lock(&tileMutex);
+    if (mode == what_to_paint::function && ranges[(int)mode].ready) {
+        max = ranges[(int)mode].field.max;
+    }
+    pthread_mutex_unlock(&tileMutex);
+    return max;
+}
+
+double Renderer::getZoom() const {
+    return zoomFactor;
 }
 
 QPointF Renderer::l2g(double x, double y) const {
@@ -149,163 +252,257 @@ QPointF Renderer::g2l(double x, double y) const {
     return QPointF(logicalX, logicalY);
 }
 
+// width x height -- узлы сетки, как в setData; поле подходит только к
+// данным той же версии и того же размера
+void Renderer::setResidualField(const double *field, int width, int height, double maxResidual,
+                                unsigned long long version) {
+    resetTiles();
+    residualField = field;
+    residualWidth = width;
+    residualHeight = height;
+    residualMax = maxResidual;
+    residualVersion = version;
+}
+
+bool Renderer::hasResidualField() const {
+    return residualField != nullptr && residualVersion == dataVersion
+        && residualWidth == dataWidth && residualHeight == dataHeight;
+}
+
+// Выводятся готовые плитки уровня tileLevel(); вместо недостающих --
+// растянутая часть ближайшего готового предка. Недостающие и недоуточнённые
+// плитки уходят в очередь фонового потока: сначала первый проход грубого
+// уровня на два ниже, затем проходы нужного уровня по очереди
 void Renderer::paintEvent(QPaintEvent *event) {
     QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing, true);
     
     // Fill background
     painter.fillRect(event->rect(), QColor("#F0F0F0"));
     
+    const int level = tileLevel();
+    const int coarse = std::max(level - 2, 0);
+    int tx1, tx2, ty1, ty2;
+    std::vector<TileRequest> missing;
+    
+    pthread_mutex_lock(&tileMutex);
+    
+    // Снимок параметров для фонового потока; ячеек на плитку столько, чтобы
+    // на экране было около mx x my ячеек при любом масштабе
+    const int viewPixels = std::max(std::max(width(), height()), 1);
+    scene.mode = mode;
+    scene.func = func;
+    scene.data = data;
+    scene.dataWidth = dataWidth;
+    scene.dataHeight = dataHeight;
+    scene.a = a;
+    scene.b = b;
+    scene.c = c;
+    scene.d = d;
+    scene.mx = visualizationWidth;
+    scene.my = visualizationHeight;
+    scene.cellsX = std::min(std::max((int)std::lround((visualizationWidth - 1.0) * TILE_PIXELS / viewPixels), 1), TILE_PIXELS);
+    scene.cellsY = std::min(std::max((int)std::lround((visualizationHeight - 1.0) * TILE_PIXELS / viewPixels), 1), TILE_PIXELS);
+    scene.residualField = hasResidualField() ? residualField : nullptr;
+    scene.residualMax = residualMax;
+    scene.generation = tileGeneration;
+    
+    // Грубый уровень только заменяет неготовые плитки, ему хватает первого прохода
+    if (coarse < level && tileRange(coarse, &tx1, &tx2, &ty1, &ty2)) {
+        const int cellsX = pass_cells(scene.cellsX, 0);
+        const int cellsY = pass_cells(scene.cellsY, 0);
+        for (int ty = ty1; ty <= ty2; ty++) {
+            for (int tx = tx1; tx <= tx2; tx++) {
+                if (findTile(coarse, tx, ty, mode) == nullptr) {
+                    missing.push_back({coarse, tx, ty, cellsX, cellsY});
+                }
+            }
+        }
+    }
+    
+    if (tileRange(level, &tx1, &tx2, &ty1, &ty2)) {
+        for (int ty = ty1; ty <= ty2; ty++) {
+            for (int tx = tx1; tx <= tx2; tx++) {
+                const QRectF target = tileRect(level, tx, ty);
+                Tile *tile = findTile(level, tx, ty, mode);
+                if (tile != nullptr) {
+                    painter.drawImage(target, tile->image);
+                    continue;
+                }
+                
+                // Плитка уровня level - k занимает 2^k x 2^k плиток уровня
+                // level; строка 0 изображения -- верхний край (наибольший y)
+                for (int k = 1; k <= level; k++) {
+                    Tile *parent = findTile(level - k, tx >> k, ty >> k, mode);
+                    if (parent == nullptr) {
+                        continue;
+                    }
+                    const double size = (double)TILE_PIXELS / (1 << k);
+                    const int subX = tx - ((tx >> k) << k);
+                    const int subY = (1 << k) - 1 - (ty - ((ty >> k) << k));
+                    painter.drawImage(target, parent->image, QRectF(subX * size, subY * size, size, size));
+                    break;
+                }
+            }
+        }
+        
+        // Проход нужен плитке, если её решётка реже; последний -- ещё и
+        // если шкала цветов уточнилась после того, как плитка нарисована
+        const unsigned int stamp = ranges[(int)mode].stamp;
+        for (int pass = 0; pass < TILE_PASSES; pass++) {
+            const int cellsX = pass_cells(scene.cellsX, pass);
+            const int cellsY = pass_cells(scene.cellsY, pass);
+            const bool last = pass == TILE_PASSES - 1;
+            if (!last && cellsX == pass_cells(scene.cellsX, pass + 1) && cellsY == pass_cells(scene.cellsY, pass + 1)) {
+                continue;   // Та же решётка, что у следующего прохода
+            }
+            for (int ty = ty1; ty <= ty2; ty++) {
+                for (int tx = tx1; tx <= tx2; tx++) {
+                    Tile *tile = findTile(level, tx, ty, mode);
+                    if (tile == nullptr || tile->cellsX < cellsX || tile->cellsY < cellsY
+                        || (last && tile->rangeStamp != stamp)) {
+                        missing.push_back({level, tx, ty, cellsX, cellsY});
+                    }
+                }
+            }
+        }
+    }
+    
+    // Очередь заменяется целиком: уточнение плиток, ушедших из вида, отменяется
+    tileRequests.clear();
+    for (size_t r = 0; r < missing.size(); r++) {
+        if (tileBusy && missing[r].level == tileCurrent.level && missing[r].tx == tileCurrent.tx
+            && missing[r].ty == tileCurrent.ty && missing[r].cellsX == tileCurrent.cellsX
+            && missing[r].cellsY == tileCurrent.cellsY) {
+            continue;
+        }
+        tileRequests.push_back(missing[r]);
+    }
+    if (!tileRequests.empty()) {
+        pthread_cond_signal(&tileWake);
+    }
+    
+    // Кадр окончательный, если ни одна видимая плитка не ждёт прохода и
+    // шкала цветов уже посчитана по всей сетке
+    const bool complete = missing.empty() && !rangePending();
+    
+    pthread_mutex_unlock(&tileMutex);
+    
     // Draw grid but grid drawing is disabled
     drawGrid(painter);
     
-    // Draw data based on mode
-    switch (mode) {
-        case what_to_paint::function:
-            drawFunction(painter);
-            break;
-        case what_to_paint::approximation:
-            drawData(painter);
-            break;
-        case what_to_paint::residual:
-            drawResidual(painter);
-            break;
-    }
+    emit framePainted(complete);
 }
 
+// Размер плиток в пикселях сетки задан через mx, my и размер окна
 void Renderer::resizeEvent(QResizeEvent *) {
+    resetTiles();
+    resizeTileCache();
+    updateVisibleRect();
+}
+
+// Левая кнопка сдвигает вид вслед за мышью
+void Renderer::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        dragging = true;
+        dragStart = event->pos();
+        dragCenter = viewCenter;
+    }
+}
+
+void Renderer::mouseMoveEvent(QMouseEvent *event) {
+    if (!dragging || width() <= 0 || height() <= 0) {
+        return;
+    }
+    
+    const double dx = (event->pos().x() - dragStart.x()) * visibleRect.width() / width();
+    const double dy = (event->pos().y() - dragStart.y()) * visibleRect.height() / height();
+    viewCenter = QPointF(dragCenter.x() - dx, dragCenter.y() + dy);
     updateVisibleRect();
+    update();
+    emit viewChanged();
+}
+
+void Renderer::mouseReleaseEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        dragging = false;
+    }
+}
+
+// Колесо меняет масштаб в sqrt(2) раз за щелчок; точка под курсором остаётся на месте
+void Renderer::wheelEvent(QWheelEvent *event) {
+    if (width() <= 0 || height() <= 0) {
+        return;
+    }
+    
+    const QPointF anchor = g2l(event->pos().x(), event->pos().y());
+    const double fx = (double)event->pos().x() / width();
+    const double fy = (double)(height() - event->pos().y()) / height();
+    
+    zoomFactor *= std::pow(2.0, event->angleDelta().y() / 240.0);
+    zoomFactor = std::min(std::max(zoomFactor, 1.0), ZOOM_MAX);
+    
+    const double viewWidth = (b - a) / zoomFactor;
+    const double viewHeight = (d - c) / zoomFactor;
+    viewCenter = QPointF(anchor.x() + (0.5 - fx) * viewWidth, anchor.y() + (0.5 - fy) * viewHeight);
+    updateVisibleRect();
+    update();
+    event->accept();
+    emit viewChanged();
 }
 
 void Renderer::updateVisibleRect() {
     // Calculate the visible rectangle in logical coordinates
-    double centerX = (a + b) / 2.0;
-    double centerY = (c + d) / 2.0;
-    
     double width = (b - a) / zoomFactor;
     double height = (d - c) / zoomFactor;
     
     visibleRect = QRectF(
-        centerX - width / 2.0,
-        centerY - height / 2.0,
+        viewCenter.x() - width / 2.0,
+        viewCenter.y() - height / 2.0,
         width,
         height
     );
 }
 
-void Renderer::setupGradients() {
+// Градиенты всех режимов; общие для виджета и пакетной отрисовки
+void Renderer::makeGradients(QLinearGradient &standard, QLinearGradient &residual, QLinearGradient &approximation) {
     // Standard gradient (синий - голубой - зеленый - желтый - красный)
-    standardGradient.setStart(0, 0);
-    standardGradient.setFinalStop(1, 0);
-    standardGradient.setCoordinateMode(QGradient::ObjectBoundingMode);
-    standardGradient.setColorAt(0.0, QColor("#0000FF")); // Синий
-    standardGradient.setColorAt(0.25, QColor("#00AAFF")); // Голубой
-    standardGradient.setColorAt(0.5, QColor("#00FF00")); // Зеленый
-    standardGradient.setColorAt(0.75, QColor("#FFFF00")); // Желтый
-    standardGradient.setColorAt(1.0, QColor("#FF0000")); // Красный
+    standard.setStart(0, 0);
+    standard.setFinalStop(1, 0);
+    standard.setCoordinateMode(QGradient::ObjectBoundingMode);
+    standard.setColorAt(0.0, QColor("#0000FF")); // Синий
+    standard.setColorAt(0.25, QColor("#00AAFF")); // Голубой
+    standard.setColorAt(0.5, QColor("#00FF00")); // Зеленый
+    standard.setColorAt(0.75, QColor("#FFFF00")); // Желтый
+    standard.setColorAt(1.0, QColor("#FF0000")); // Красный
     
     // Residual gradient (зеленый - желтый - оранжевый - красный)
-    residualGradient.setStart(0, 0);
-    residualGradient.setFinalStop(1, 0);
-    residualGradient.setCoordinateMode(QGradient::ObjectBoundingMode);
-    residualGradient.setColorAt(0.0, QColor("#00AA00")); // Зеленый (минимальная погрешность)
-    residualGradient.setColorAt(0.3, QColor("#AAFF00")); // Светло-зеленый
-    residualGradient.setColorAt(0.6, QColor("#FFAA00")); // Оранжевый
-    residualGradient.setColorAt(1.0, QColor("#FF0000")); // Красный (максимальная погрешность)
+    residual.setStart(0, 0);
+    residual.setFinalStop(1, 0);
+    residual.setCoordinateMode(QGradient::ObjectBoundingMode);
+    residual.setColorAt(0.0, QColor("#00AA00")); // Зеленый (минимальная погрешность)
+    residual.setColorAt(0.3, QColor("#AAFF00")); // Светло-зеленый
+    residual.setColorAt(0.6, QColor("#FFAA00")); // Оранжевый
+    residual.setColorAt(1.0, QColor("#FF0000")); // Красный (максимальная погрешность)
     
     // Approximation gradient (сохраняем, но не используем)
-    approximationGradient.setStart(0, 0);
-    approximationGradient.setFinalStop(1, 0);
-    approximationGradient.setCoordinateMode(QGradient::ObjectBoundingMode);
-    approximationGradient.setColorAt(0.0, QColor("#00FFFF")); // Голубой
-    approximationGradient.setColorAt(1.0, QColor("#FFA500")); // Оранжевый
-}
-
-QColor Renderer::getColor(double value, double min, double max) {
-    double d;
-    // Если диапазон значений очень мал (константная функция), используем искусственный разброс
-    if (std::fabs(max-min) < 1e-16) {
-        // Для константных функций создаем искусственный градиент
-        // Проверка: если значение близко к 1, это вероятно функция f(x,y) = 1
-        bool isConstantOne = (std::fabs(value - 1.0) < 1e-16);
-        
-        if (mode == what_to_paint::function) {
-            if (isConstantOne) {
-                // Для f(x,y) = 1 используем фиксированный средний цвет (зеленый)
-                min = 0.0;
-                max = 1.0;
-                value = 0.5; // Зеленый (средний цвет в градиенте)
-            } else {
-                // Для других константных функций используем полный градиент
-                min = 0.0;
-                max = 1.0;
-                value = 0.5; // Середина градиента
-            }
-        } else if (mode == what_to_paint::approximation) {
-            if (isConstantOne) {
-                // Для аппроксимации f(x,y) = 1 используем тот же зеленый
-                min = 0.0;
-                max = 1.0;
-                value = 0.5; // Зеленый (средний цвет в градиенте)
-            } else {
-                min = 0.0;
-                max = 1.0;
-                value = 0.5; // Середина градиента
-            }
-        } else {
-            // Для погрешности (residual) - нулевая погрешность, используем начало градиента
-            min = 0.0;
-            max = 1.0;
-            value = 0.0; // Начало градиента (зеленый для минимальной погрешности)
-        }
-        d = 1e-16;
-    } else {
-        d = max - min;
-    }
-    
-    double normalizedValue = (value - min) / d;
-    normalizedValue = qBound(0.0, normalizedValue, 1.0);
-    
-    // Choose appropriate gradient based on mode
-    QLinearGradient *gradient;
-    switch (mode) {
-        case what_to_paint::function:
-        case what_to_paint::approximation:  // Используем один и тот же градиент для функции и аппроксимации
-            gradient = &standardGradient;
-            break;
-        case what_to_paint::residual:
-            gradient = &residualGradient;
-            break;
-        default:
-            gradient = &standardGradient;
-    }
-    
-    // Sample gradient at the normalized value position
-    QGradientStops stops = gradient->stops();
-    
-    if (stops.size() < 2) {
-        return QColor(0, 0, 0);
-    }
-    
-    for (int i = 0; i < stops.size() - 1; i++) {
-        double pos1 = stops[i].first;
-        double pos2 = stops[i + 1].first;
-        
-        if (normalizedValue >= pos1 && normalizedValue <= pos2) {
-            double t = (normalizedValue - pos1) / (pos2 - pos1);
-            
-            QColor color1 = stops[i].second;
-            QColor color2 = stops[i + 1].second;
-            
-            int r = color1.red() + t * (color2.red() - color1.red());
-            int g = color1.green() + t * (color2.green() - color1.green());
-            int b = color1.blue() + t * (color2.blue() - color1.blue());
-            
-            return QColor(r, g, b);
-        }
-    }
-    
-    return QColor(0, 0, 0);
+    approximation.setStart(0, 0);
+    approximation.setFinalStop(1, 0);
+    approximation.setCoordinateMode(QGradient::ObjectBoundingMode);
+    approximation.setColorAt(0.0, QColor("#00FFFF")); // Голубой
+    approximation.setColorAt(1.0, QColor("#FFA500")); // Оранжевый
+}
+
+// Константное поле функции и аппроксимации -- середина шкалы, погрешности -- начало
+void Renderer::colorTables(ColorLut *standard, ColorLut *residual) {
+    QLinearGradient gradients[3];
+    makeGradients(gradients[0], gradients[1], gradients[2]);
+    make_lut(gradients[0], 0.5, standard);
+    make_lut(gradients[1], 0.0, residual);
+}
+
+void Renderer::setupGradients() {
+    makeGradients(standardGradient, residualGradient, approximationGradient);
+    colorTables(&standardLut, &residualLut);
 }
 
 void Renderer::drawGrid(QPainter &painter) {
@@ -371,420 +568,441 @@ void Renderer::drawGrid(QPainter &painter) {
     }
 }
 
-void Renderer::drawData(QPainter &painter) {
-    if (!data || dataWidth <= 0 || dataHeight <= 0) {
-        return;
-    }
-    
-    // Используем параметры детализации визуализации, как и в drawFunction()
-    const int nx = visualizationWidth;
-    const int ny = visualizationHeight;
-    
-    // Создаем массив для интерполированных данных
-    std::vector<std::vector<double>> values(nx, std::vector<double>(ny));
+// Уровень, на котором плитка занимает на экране около TILE_PIXELS пикселей
+int Renderer::tileLevel() const {
+    const double tilesAcross = std::max(width(), height()) * zoomFactor / TILE_PIXELS;
+    const int level = tilesAcross > 1 ? (int)std::lround(std::log2(tilesAcross)) : 0;
+    return std::min(level, TILE_MAX_LEVEL);
+}
+
+// Плитки уровня level, пересекающие видимую часть области; false, если таких нет
+bool Renderer::tileRange(int level, int *tx1, int *tx2, int *ty1, int *ty2) const {
+    const double n = (double)(1 << level);
+    const double tileWidth = (b - a) / n;
+    const double tileHeight = (d - c) / n;
     
-    // Проверяем, являются ли данные константными
-    double firstValue = data[0];
-    bool isConstantData = true;
+    // Вид можно увести далеко за область, поэтому номера ограничиваются до приведения к int
+    const double x1 = std::floor((visibleRect.left() - a) / tileWidth);
+    const double x2 = std::ceil((visibleRect.right() - a) / tileWidth) - 1;
+    const double y1 = std::floor((visibleRect.top() - c) / tileHeight);
+    const double y2 = std::ceil((visibleRect.bottom() - c) / tileHeight) - 1;
+    if (x2 < 0 || y2 < 0 || x1 > n - 1 || y1 > n - 1) {
+        return false;
+    }
     
-    for (int i = 0; i < dataWidth * dataHeight && isConstantData; i++) {
-        if (std::fabs(data[i] - firstValue) > 1e-16) {
-            isConstantData = false;
+    *tx1 = (int)std::max(x1, 0.0);
+    *tx2 = (int)std::min(x2, n - 1);
+    *ty1 = (int)std::max(y1, 0.0);
+    *ty2 = (int)std::min(y2, n - 1);
+    return *tx1 <= *tx2 && *ty1 <= *ty2;
+}
+
+// Прямоугольник плитки на экране
+QRectF Renderer::tileRect(int level, int tx, int ty) const {
+    const double n = (double)(1 << level);
+    const double tileWidth = (b - a) / n;
+    const double tileHeight = (d - c) / n;
+    return QRectF(l2g(a + tx * tileWidth, c + (ty + 1) * tileHeight),
+                  l2g(a + (tx + 1) * tileWidth, c + ty * tileHeight));
+}
+
+// Вызывается под tileMutex; найденная плитка отмечается как использованная
+Tile *Renderer::findTile(int level, int tx, int ty, what_to_paint mode) {
+    for (size_t t = 0; t < tiles.size(); t++) {
+        Tile *tile = &tiles[t];
+        if (tile->level == level && tile->tx == tx && tile->ty == ty && tile->mode == mode
+            && tile->generation == tileGeneration && !tile->image.isNull()) {
+            tile->used = ++tileClock;
+            return tile;
         }
     }
+    return nullptr;
+}
+
+// Вызывается под tileMutex. Плитка заменяет себя же с более редкой решёткой
+// или старой шкалой, иначе занимает место устаревшей или пустой, иначе --
+// дольше всех не выводившейся
+void Renderer::storeTile(const TileRequest &request, what_to_paint mode, unsigned int rangeStamp, QImage &image) {
+    Tile *slot = nullptr;
+    unsigned long long oldest = 0;
     
-    // Интерполируем данные на визуализационную сетку
-    for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny; j++) {
-            // Преобразуем индексы сетки визуализации в координаты области
-            double x = visibleRect.left() + visibleRect.width() * i / (nx - 1);
-            double y = visibleRect.top() + visibleRect.height() * j / (ny - 1);
-            
-            // Находим соответствующую ячейку в исходной сетке данных
-            double relX = (x - a) / (b - a);
-            double relY = (y - c) / (d - c);
-            
-            if (relX < 0) relX = 0;
-            if (relX > 1) relX = 1;
-            if (relY < 0) relY = 0;
-            if (relY > 1) relY = 1;
-            
-            double dataX = relX * (dataWidth - 1);
-            double dataY = relY * (dataHeight - 1);
-            
-            int dataX_floor = static_cast<int>(dataX);
-            int dataY_floor = static_cast<int>(dataY);
-            
-            dataX_floor = std::min(dataX_floor, dataWidth - 2);
-            dataY_floor = std::min(dataY_floor, dataHeight - 2);
-            
-            double fracX = dataX - dataX_floor;
-            double fracY = dataY - dataY_floor;
-            
-            // Билинейная интерполяция
-            double v00 = data[dataY_floor * dataWidth + dataX_floor];
-            double v10 = data[dataY_floor * dataWidth + (dataX_floor + 1)];
-            double v01 = data[(dataY_floor + 1) * dataWidth + dataX_floor];
-            double v11 = data[(dataY_floor + 1) * dataWidth + (dataX_floor + 1)];
-            
-            double v0 = v00 * (1 - fracX) + v10 * fracX;
-            double v1 = v01 * (1 - fracX) + v11 * fracX;
-            
-            values[i][j] = v0 * (1 - fracY) + v1 * fracY;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        Tile *tile = &tiles[t];
+        const bool stale = tile->generation != tileGeneration || tile->image.isNull();
+        if (!stale && tile->level == request.level && tile->tx == request.tx && tile->ty == request.ty
+            && tile->mode == mode) {
+            if (tile->rangeStamp == rangeStamp && tile->cellsX >= request.cellsX && tile->cellsY >= request.cellsY) {
+                return;     // Уже есть не хуже
+            }
+            slot = tile;
+            break;
+        }
+        const unsigned long long used = stale ? 0 : tile->used;
+        if (slot == nullptr || used < oldest) {
+            slot = tile;
+            oldest = used;
         }
     }
     
-    // Находим min и max значения
-    double maxVal = -INFINITY;
-    double minVal = INFINITY;
+    slot->level = request.level;
+    slot->tx = request.tx;
+    slot->ty = request.ty;
+    slot->mode = mode;
+    slot->cellsX = request.cellsX;
+    slot->cellsY = request.cellsY;
+    slot->rangeStamp = rangeStamp;
+    slot->generation = tileGeneration;
+    slot->used = ++tileClock;
+    slot->image = image;
+}
+
+// Все плитки и шкалы цветов устаревают; возвращается, когда фоновый поток
+// бросил текущую работу (он проверяет поколение между полосами выборки),
+// после чего данные и параметры можно менять
+void Renderer::resetTiles() {
+    pthread_mutex_lock(&tileMutex);
+    tileGeneration++;
+    tileRequests.clear();
+    for (int m = 0; m < 3; m++) {
+        ranges[m].ready = false;
+        ranges[m].exact = false;
+    }
+    while (tileBusy) {
+        pthread_cond_wait(&tileIdle, &tileMutex);
+    }
+    pthread_mutex_unlock(&tileMutex);
+}
+
+// Кэш вмещает дважды все видимые плитки нужного и грубого уровней при любом
+// масштабе, иначе кадр вытеснял бы плитки, которые сам же выводит. На уровне
+// tileLevel() на большую сторону окна приходится не больше sqrt(2) * max(w, h)
+// / TILE_PIXELS плиток, и ещё по одной на неполные плитки с краёв
+void Renderer::resizeTileCache() {
+    const double across = std::sqrt(2.0) * std::max(std::max(width(), height()), 1) / TILE_PIXELS;
+    const int fine = (int)across + 2;
+    const int coarse = (int)(across / 4) + 2;
+    const size_t size = std::max(TILE_CACHE_SIZE, 2 * (fine * fine + coarse * coarse));
     
-    for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny; j++) {
-            maxVal = std::max(maxVal, values[i][j]);
-            minVal = std::min(minVal, values[i][j]);
+    pthread_mutex_lock(&tileMutex);
+    if (tiles.size() != size) {
+        tiles.assign(size, Tile());
+        for (size_t t = 0; t < size; t++) {
+            tiles[t].level = -1;
+            tiles[t].cellsX = 0;
+            tiles[t].cellsY = 0;
+            tiles[t].rangeStamp = 0;
+            tiles[t].generation = 0;
+            tiles[t].used = 0;
         }
     }
-    
-    // Если данные константны, делаем то же самое, что и в drawFunction()
-    if (isConstantData) {
-        bool isConstantOne = (std::fabs(firstValue - 1.0) < 1e-16);
+    pthread_mutex_unlock(&tileMutex);
+}
+
+void *Renderer::tileWorker(void *ptr) {
+    ((Renderer *)ptr)->tileLoop();
+    return nullptr;
+}
+
+// Вызывается под tileMutex: видимые плитки готовы, а шкала цветов текущего
+// режима пока предварительная
+bool Renderer::rangePending() const {
+    const ColorRange &range = ranges[(int)scene.mode];
+    return scene.generation == tileGeneration && range.ready && !range.exact;
+}
+
+// Фоновый поток: берёт плитки из очереди и рисует их без мьютекса; плитка
+// устаревшего поколения выбрасывается. Готовая плитка перерисовывает виджет
+// через очередь событий GUI-потока. Когда очередь пуста, уточняет шкалу
+// цветов; если она изменилась, плитки перерисовываются последним проходом
+void Renderer::tileLoop() {
+    pthread_mutex_lock(&tileMutex);
+    for (;;) {
+        while (!tileStop && tileRequests.empty() && !rangePending()) {
+            pthread_cond_wait(&tileWake, &tileMutex);
+        }
+        if (tileStop) {
+            break;
+        }
         
-        if (isConstantOne) {
-            // Для data = 1 во всех точках используем однородный зеленый цвет
-            // Но это должно соответствовать drawFunction(), поэтому не меняем данные
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    values[i][j] = 0.5; // Зеленый цвет в градиенте
+        TileScene s = scene;
+        if (tileRequests.empty()) {
+            tileBusy = true;
+            tileCurrent.level = -1;
+            pthread_mutex_unlock(&tileMutex);
+            
+            ColorRange range;
+            const bool done = computeRange(s, s.mx, s.my, &range);
+            
+            pthread_mutex_lock(&tileMutex);
+            tileBusy = false;
+            pthread_cond_broadcast(&tileIdle);
+            ColorRange *current = &ranges[(int)s.mode];
+            if (done && s.generation == tileGeneration) {
+                if (same_range(range, *current)) {
+                    // Плитки не меняются, но следующий кадр уже окончательный
+                    current->exact = true;
+                    QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+                } else {
+                    range.stamp = current->stamp + 1;
+                    *current = range;
+                    QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+                    QMetaObject::invokeMethod(this, "viewChanged", Qt::QueuedConnection);
                 }
             }
-            minVal = 0.0;
-            maxVal = 1.0;
-        } else {
-            // Для других константных данных создаем искусственный градиент,
-            // как в drawFunction()
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    double relX = static_cast<double>(i) / (nx - 1);
-                    double relY = static_cast<double>(j) / (ny - 1);
-                    
-                    values[i][j] = relX * relY + (1 - relX) * (1 - relY);
-                }
+            continue;
+        }
+        
+        TileRequest request = tileRequests.front();
+        tileRequests.erase(tileRequests.begin());
+        if (s.generation != tileGeneration) {
+            continue;
+        }
+        
+        ColorRange range = ranges[(int)s.mode];
+        const bool newRange = !range.ready;
+        tileBusy = true;
+        tileCurrent = request;
+        pthread_mutex_unlock(&tileMutex);
+        
+        // Первой плитке поколения хватает предварительной шкалы
+        bool done = true;
+        if (newRange) {
+            done = computeRange(s, std::min(s.mx, RANGE_PREVIEW), std::min(s.my, RANGE_PREVIEW), &range);
+        }
+        QImage image;
+        done = done && renderTile(s, range, request, image);
+        
+        pthread_mutex_lock(&tileMutex);
+        tileBusy = false;
+        pthread_cond_broadcast(&tileIdle);
+        if (done && s.generation == tileGeneration) {
+            if (newRange) {
+                range.stamp = ranges[(int)s.mode].stamp + 1;
+                ranges[(int)s.mode] = range;
+            }
+            storeTile(request, s.mode, range.stamp, image);
+            QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+            if (newRange) {
+                // Максимум для панели информации
+                QMetaObject::invokeMethod(this, "viewChanged", Qt::QueuedConnection);
             }
-            minVal = 0.0;
-            maxVal = 1.0;
         }
     }
-    
-    // Обновление maxValue для отображения
-    maxValue = maxVal;
-    
-    // Отрисовка ячеек, как в drawFunction()
-    for (int i = 0; i < nx - 1; i++) {
-        for (int j = 0; j < ny - 1; j++) {
-            double x1 = visibleRect.left() + visibleRect.width() * i / (nx - 1);
-            double y1 = visibleRect.top() + visibleRect.height() * j / (ny - 1);
-            double x2 = visibleRect.left() + visibleRect.width() * (i + 1) / (nx - 1);
-            double y2 = visibleRect.top() + visibleRect.height() * (j + 1) / (ny - 1);
-            
-            QColor color = getColor(values[i][j], minVal, maxVal);
-            
-            QPointF p1 = l2g(x1, y1);
-            QPointF p2 = l2g(x2, y1);
-            QPointF p3 = l2g(x2, y2);
-            QPointF p4 = l2g(x1, y2);
-            
-            QPolygonF polygon;
-            polygon << p1 << p2 << p3 << p4;
-            
-            painter.setBrush(color);
-            painter.setPen(Qt::NoPen);
-            painter.drawPolygon(polygon);
+    pthread_mutex_unlock(&tileMutex);
+}
+
+// Строки [0, rows) выборки раздаются пулу полосами; false, если поколение
+// сменилось и выборку надо бросить
+bool Renderer::sampleBands(unsigned long long generation, int rows, void (*fn)(void *, int, int), void *ctx) {
+    const int bandRows = std::max(TILE_BAND_ROWS, tilePool.size * STEAL_CHUNKS);
+    Band band = {fn, ctx, 0};
+    for (band.first = 0; band.first < rows; band.first += bandRows) {
+        if (tileGeneration.load(std::memory_order_relaxed) != generation) {
+            return false;
         }
+        steal_pool_for(&tilePool, std::min(bandRows, rows - band.first), band_rows, &band);
     }
+    return true;
 }
 
-void Renderer::drawResidual(QPainter &painter) {
-    if (!data || !func || dataWidth <= 0 || dataHeight <= 0) {
-        return;
-    }
+// Шкала цветов по всей области [a, b] x [c, d], а не по видимой части:
+// иначе соседние плитки и плитки разных уровней не совпадали бы по цвету.
+// Функция оценивается по сетке mx x my; false, если выборку отменили
+bool Renderer::computeRange(const TileScene &s, int mx, int my, ColorRange *range) {
+    range->ready = true;
+    range->exact = s.mode != what_to_paint::function || (mx >= s.mx && my >= s.my);
+    range->stamp = 0;
+    range->field.min = 0.0;
+    range->field.max = 1.0;
+    range->field.pseudo = false;
+    range->field.constOne = false;
     
-    // Используем параметры детализации визуализации
-    const int nx = visualizationWidth;
-    const int ny = visualizationHeight;
-    
-    double hx = (b - a) / (dataWidth - 1);
-    double hy = (d - c) / (dataHeight - 1);
-    double maxResidual = 0.0;
-    
-    // Проверяем, является ли функция константной
-    bool isConstantFunction = true;
-    double firstFuncValue = func(a, c);
-    
-    // Проверка нескольких точек для определения константности функции
-    for (int i = 0; i < 5; ++i) {
-        for (int j = 0; j < 5; ++j) {
-            double x = a + (b - a) * i / 4.0;
-            double y = c + (d - c) * j / 4.0;
-            if (std::fabs(func(x, y) - firstFuncValue) > 1e-16) {
-                isConstantFunction = false;
+    switch (s.mode) {
+        case what_to_paint::function: {
+            if (!s.func || mx < 2 || my < 2) {
                 break;
             }
-        }
-        if (!isConstantFunction) break;
-    }
-    
-    // Сначала вычислим погрешность на исходной сетке данных
-    std::vector<std::vector<double>> originalResidual;
-    originalResidual.resize(dataWidth, std::vector<double>(dataHeight));
-    
-    // Проверяем, совпадают ли значения функции и аппроксимации
-    bool zeroResidual = true;
-    
-    // Расчет максимальной погрешности по ТЗ на исходной сетке
-    for (int i = 0; i < dataWidth - 1; i++) {
-        for (int j = 0; j < dataHeight - 1; j++) {
-            // Получение значений в узлах
-            double node1 = data[j * dataWidth + i]; // (i,j)
-            double node2 = data[j * dataWidth + i + 1]; // (i+1,j)
-            double node3 = data[(j + 1) * dataWidth + i + 1]; // (i+1,j+1)
-            double node4 = data[(j + 1) * dataWidth + i]; // (i,j+1)
-            
-            // Нижний треугольник - точка с координатами (i+2/3, j+1/3)
-            double x_low = a + hx * (i + 2.0/3.0);
-            double y_low = c + hy * (j + 1.0/3.0);
-            double exact_low = func(x_low, y_low);
-            
-            // Линейная интерполяция для нижнего треугольника
-            double approx_low = (node1 + node2 + node3) / 3.0;
-            double residual_low = std::fabs(exact_low - approx_low);
-            
-            // Верхний треугольник - точка с координатами (i+1/3, j+2/3)
-            double x_up = a + hx * (i + 1.0/3.0);
-            double y_up = c + hy * (j + 2.0/3.0);
-            double exact_up = func(x_up, y_up);
             
-            // Линейная интерполяция для верхнего треугольника
-            double approx_up = (node1 + node3 + node4) / 3.0;
-            double residual_up = std::fabs(exact_up - approx_up);
-            
-            // Сохраняем значения погрешности
-            originalResidual[i][j] = std::max(residual_low, residual_up);
-            
-            if (residual_low > 1e-16 || residual_up > 1e-16) {
-                zeroResidual = false;
+            // Значения функции на сетке mx x my по всей области
+            std::vector<double> rowMin(my), rowMax(my);
+            FunctionRange samples = {rowMin.data(), rowMax.data(), s.func, s.a, s.c, s.b - s.a, s.d - s.c, mx, my};
+            if (!sampleBands(s.generation, my, sample_range, &samples)) {
+                return false;
             }
             
-            maxResidual = std::max(maxResidual, std::max(residual_low, residual_up));
+            double maxVal = -INFINITY;
+            double minVal = INFINITY;
+            for (int j = 0; j < my; j++) {
+                maxVal = std::max(maxVal, rowMax[j]);
+                minVal = std::min(minVal, rowMin[j]);
+            }
+            function_range(minVal, maxVal, s.func(s.a, s.c), &range->field);
+            break;
         }
-    }
-    
-    // Теперь создаём сетку погрешности с нужной детализацией
-    std::vector<std::vector<double>> residualMatrix(nx, std::vector<double>(ny));
-    
-    // Интерполируем исходную погрешность на новую сетку
-    for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny; j++) {
-            // Соответствующие координаты в области функции
-            double x = a + (b - a) * i / (nx - 1);
-            double y = c + (d - c) * j / (ny - 1);
+        case what_to_paint::approximation: {
+            if (dataPyramid.levels == 0) {
+                break;
+            }
             
-            // Находим соответствующую ячейку в исходной сетке данных
-            int dataX = static_cast<int>((x - a) / hx);
-            int dataY = static_cast<int>((y - c) / hy);
+            data_range(&dataPyramid, &range->field);
+            break;
+        }
+        case what_to_paint::residual: {
+            residualPyramid.levels = 0;
+            if (!s.data || !s.func || s.dataWidth < 2 || s.dataHeight < 2) {
+                break;
+            }
             
-            // Ограничиваем индексы
-            dataX = std::min(std::max(dataX, 0), dataWidth - 2);
-            dataY = std::min(std::max(dataY, 0), dataHeight - 2);
+            // Погрешность на исходной сетке данных: готовое поле от решателя,
+            // иначе считаем здесь
+            const int cellsX = s.dataWidth - 1;
+            const int cellsY = s.dataHeight - 1;
+            const double *field = s.residualField;
+            double maxResidual = s.residualMax;
             
-            // Для простоты берем значение погрешности из найденной ячейки оригинальной сетки
-            residualMatrix[i][j] = originalResidual[dataX][dataY];
-        }
-    }
-    
-    // Если функция константная и погрешность нулевая или близка к нулю
-    if ((isConstantFunction || zeroResidual) && maxResidual < 1e-16) {
-        // Используем искусственный градиент для визуализации
-        for (int i = 0; i < nx; i++) {
-            for (int j = 0; j < ny; j++) {
-                double relX = static_cast<double>(i) / (nx - 1);
-                double relY = static_cast<double>(j) / (ny - 1);
+            if (field == nullptr) {
+                double hx = (s.b - s.a) / cellsX;
+                double hy = (s.d - s.c) / cellsY;
+                residualSampled.resize(cellsX * cellsY);
+                ResidualSamples samples = {residualSampled.data(), s.data, s.func, s.dataWidth, s.dataHeight,
+                                           s.a, s.c, hx, hy};
+                if (!sampleBands(s.generation, cellsY, sample_residual, &samples)) {
+                    return false;
+                }
                 
-                // Создаем псевдопогрешность, которая будет просто близка к нулю
-                // Это позволит нам увидеть зеленый цвет (минимальная погрешность)
-                residualMatrix[i][j] = (relX * relY) * 1e-17;
+                maxResidual = 0.0;
+                for (size_t i = 0; i < residualSampled.size(); i++) {
+                    maxResidual = std::max(maxResidual, residualSampled[i]);
+                }
+                field = residualSampled.data();
             }
+            
+            // При отдалении ячейка визуализации берёт максимум по своему блоку ячеек данных
+            pyramid_build(&residualPyramid, field, cellsX, cellsY, &tilePool);
+            residual_range(maxResidual, &range->field);
+            break;
         }
-        maxResidual = 1e-17;
     }
+    return true;
+}
+
+// Плитка (tx, ty) уровня level: значения в узлах решётки прохода cellsX x
+// cellsY ячеек, растянутой на плитку, затем растеризация в TILE_PIXELS x
+// TILE_PIXELS; false, если работу отменили
+bool Renderer::renderTile(const TileScene &s, const ColorRange &range, const TileRequest &request, QImage &image) {
+    image = QImage(TILE_PIXELS, TILE_PIXELS, QImage::Format_RGB32);
+    const unsigned int background = QColor("#F0F0F0").rgb();
     
-    // Обновление maxValue с вычисленной максимальной погрешностью
-    maxValue = maxResidual;
-    
-    // Проверяем, являются ли невязки константными
-    double firstValue = residualMatrix[0][0];
-    bool isConstantResidual = true;
+    const double n = (double)(1 << request.level);
+    const double tileWidth = (s.b - s.a) / n;
+    const double tileHeight = (s.d - s.c) / n;
+    const double tileLeft = s.a + request.tx * tileWidth;
+    const double tileTop = s.c + request.ty * tileHeight;
+    const int nx = request.cellsX + 1;
+    const int ny = request.cellsY + 1;
+    std::vector<double> values(nx * ny);
+    const ColorLut *lut = &standardLut;
     
-    for (int i = 0; i < nx && isConstantResidual; i++) {
-        for (int j = 0; j < ny && isConstantResidual; j++) {
-            if (std::fabs(residualMatrix[i][j] - firstValue) > 1e-16) {
-                isConstantResidual = false;
+    switch (s.mode) {
+        case what_to_paint::function: {
+            if (!s.func) {
+                image.fill(background);
+                return true;
             }
-        }
-    }
-    
-    // Если невязки константны, проверяем, равны ли они 1
-    if (isConstantResidual) {
-        bool isConstantOne = (std::fabs(firstValue - 1.0) < 1e-16);
-        
-        if (isConstantOne) {
-            // Для residual = 1 во всех точках используем однородный зеленый цвет
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    residualMatrix[i][j] = 0.5; // Используем значение 0.5 для получения зеленого цвета
-                }
-            }
-        } else {
-            // Для других константных невязок создаем искусственный градиент
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    // Используем координаты для создания псевдоградиента
-                    double relX = static_cast<double>(i) / (nx - 1);
-                    double relY = static_cast<double>(j) / (ny - 1);
-                    
-                    // Создаем интересный паттерн на основе координат
-                    residualMatrix[i][j] = relX * relY + (1 - relX) * (1 - relY);
-                }
+            FunctionSamples samples = {values.data(), s.func, tileLeft, tileTop, tileWidth, tileHeight, nx, ny};
+            if (!sampleBands(s.generation, ny, sample_function, &samples)) {
+                return false;
             }
+            break;
         }
-    }
-    
-    // Отрисовка ячеек по сетке визуализации
-    for (int i = 0; i < nx - 1; i++) {
-        for (int j = 0; j < ny - 1; j++) {
-            // Вычисляем координаты точек в математической области
-            double x1 = a + (b - a) * i / (nx - 1);
-            double y1 = c + (d - c) * j / (ny - 1);
-            double x2 = a + (b - a) * (i + 1) / (nx - 1);
-            double y2 = c + (d - c) * (j + 1) / (ny - 1);
-            
-            // Преобразуем в экранные координаты
-            QPointF p1 = l2g(x1, y1);
-            QPointF p2 = l2g(x2, y1);
-            QPointF p3 = l2g(x2, y2);
-            QPointF p4 = l2g(x1, y2);
-            
-            // Цвет для этой ячейки
-            QColor color = getColor(residualMatrix[i][j], 0.0, maxResidual);
+        case what_to_paint::approximation: {
+            if (!s.data || dataPyramid.levels == 0 || s.dataWidth < 2 || s.dataHeight < 2) {
+                image.fill(background);
+                return true;
+            }
             
-            // Рисуем нижний треугольник (1,2,3)
-            QPolygonF triangle_low;
-            triangle_low << p1 << p2 << p3;
+            int dataLevel = sample_level(&dataPyramid, s.dataWidth - 1, s.dataHeight - 1,
+                                         n * request.cellsX, n * request.cellsY);
             
-            painter.setBrush(color);
-            painter.setPen(Qt::NoPen);
-            painter.drawPolygon(triangle_low);
+            DataSamples samples = {values.data(), &dataPyramid, dataLevel, s.dataWidth, s.dataHeight,
+                                   s.a, s.b, s.c, s.d, tileLeft, tileTop, tileWidth, tileHeight, nx, ny};
+            if (!sampleBands(s.generation, ny, sample_data, &samples)) {
+                return false;
+            }
+            break;
+        }
+        case what_to_paint::residual: {
+            if (residualPyramid.levels == 0) {
+                image.fill(background);
+                return true;
+            }
+            lut = &residualLut;
             
-            // Рисуем верхний треугольник (1,3,4)
-            QPolygonF triangle_up;
-            triangle_up << p1 << p3 << p4;
+            const int cellsX = s.dataWidth - 1;
+            const int cellsY = s.dataHeight - 1;
+            int cellLevel = sample_level(&residualPyramid, cellsX, cellsY, n * request.cellsX, n * request.cellsY);
             
-            painter.setBrush(color);
-            painter.setPen(Qt::NoPen);
-            painter.drawPolygon(triangle_up);
+            CellSamples samples = {values.data(), &residualPyramid, cellLevel, cellsX, cellsY,
+                                   s.a, s.c, (s.b - s.a) / cellsX, (s.d - s.c) / cellsY,
+                                   tileLeft, tileTop, tileWidth, tileHeight, nx, ny};
+            if (!sampleBands(s.generation, ny, sample_cells, &samples)) {
+                return false;
+            }
+            break;
         }
     }
+    
+    constant_fill(&range.field, values.data(), nx, ny, tileLeft, tileTop, tileWidth, tileHeight, s.a, s.b, s.c, s.d);
+    
+    // Решётка покрывает плитку целиком, фон не нужен
+    RasterGrid grid = {values.data(), nx, ny, range.field.min, range.field.max,
+                       tileLeft, tileTop, tileWidth, tileHeight};
+    std::vector<int> columns(TILE_PIXELS);
+    std::vector<unsigned int> colors(raster_color_count(&grid));
+    
+    Raster raster;
+    raster.grid = &grid;
+    raster.lut = lut;
+    raster.pixels = reinterpret_cast<unsigned int *>(image.bits());
+    raster.stride = image.bytesPerLine() / 4;
+    raster.width = TILE_PIXELS;
+    raster.height = TILE_PIXELS;
+    raster.left = tileLeft;
+    raster.top = tileTop;
+    raster.view_width = tileWidth;
+    raster.view_height = tileHeight;
+    raster.background = background;
+    raster.columns = columns.data();
+    raster.colors = colors.data();
+    
+    raster_columns(&raster);
+    return sampleBands(s.generation, ny - 1, color_chunk, &raster)
+        && sampleBands(s.generation, raster.height, raster_chunk, &raster);
 }
 
-void Renderer::drawFunction(QPainter &painter) {
-    if (!func) {
+// Максимум погрешности по ТЗ на исходной сетке, как в computeRange()
+void Renderer::calculateMaxResidual() {
+    if (!data || !func || dataWidth < 2 || dataHeight < 2) {
+        maxValue = 0.0;
         return;
     }
-    
-    // Используем параметры детализации визуализации
-    const int nx = visualizationWidth;
-    const int ny = visualizationHeight;
-    std::vector<std::vector<double>> values(nx, std::vector<double>(ny));
-    double maxVal = -INFINITY;
-    double minVal = INFINITY;
-    
-    bool isConstantFunction = true; // Флаг для определения константной функции
-    double firstValue = 0.0;
-    
-    // Вычисляем значения функции и проверяем, является ли она константной
-    for (int i = 0; i < nx; i++) {
-        for (int j = 0; j < ny; j++) {
-            double x = visibleRect.left() + visibleRect.width() * i / (nx - 1);
-            double y = visibleRect.top() + visibleRect.height() * j / (ny - 1);
-            
-            values[i][j] = func(x, y);
-            
-            if (i == 0 && j == 0) {
-                firstValue = values[i][j];
-            } else if (std::fabs(values[i][j] - firstValue) > 1e-6) {
-                isConstantFunction = false;
-            }
-            
-            maxVal = std::max(maxVal, values[i][j]);
-            minVal = std::min(minVal, values[i][j]);
-        }
+    if (hasResidualField()) {
+        maxValue = residualMax;
+        return;
     }
     
-    // Если функция константная, проверяем, является ли она f(x,y) = 1
-    if (isConstantFunction) {
-        bool isConstantOne = (std::fabs(firstValue - 1.0) < 1e-6);
-        
-        if (isConstantOne) {
-            // Для f(x,y) = 1 используем однородный зеленый цвет
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    values[i][j] = 0.5; // Используем значение 0.5 для получения зеленого цвета
-                }
-            }
-            minVal = 0.0;
-            maxVal = 1.0;
-        } else {
-            // Для других константных функций создаем искусственный градиент
-            for (int i = 0; i < nx; i++) {
-                for (int j = 0; j < ny; j++) {
-                    // Используем координаты для создания псевдоградиента
-                    double relX = static_cast<double>(i) / (nx - 1);
-                    double relY = static_cast<double>(j) / (ny - 1);
-                    
-                    // Создаем интересный паттерн на основе координат
-                    values[i][j] = relX * relY + (1 - relX) * (1 - relY);
-                }
-            }
-            minVal = 0.0;
-            maxVal = 1.0;
-        }
-    }
+    double hx = (b - a) / (dataWidth - 1);
+    double hy = (d - c) / (dataHeight - 1);
+    std::vector<double> residual((dataWidth - 1) * (dataHeight - 1));
     
-    // Draw colored cells
-    for (int i = 0; i < nx - 1; i++) {
-        for (int j = 0; j < ny - 1; j++) {
-            double x1 = visibleRect.left() + visibleRect.width() * i / (nx - 1);
-            double y1 = visibleRect.top() + visibleRect.height() * j / (ny - 1);
-            double x2 = visibleRect.left() + visibleRect.width() * (i + 1) / (nx - 1);
-            double y2 = visibleRect.top() + visibleRect.height() * (j + 1) / (ny - 1);
-            
-            QColor color = getColor(values[i][j], minVal, maxVal);
-            
-            QPointF p1 = l2g(x1, y1);
-            QPointF p2 = l2g(x2, y1);
-            QPointF p3 = l2g(x2, y2);
-            QPointF p4 = l2g(x1, y2);
-            
-            QPolygonF polygon;
-            polygon << p1 << p2 << p3 << p4;
-            
-            painter.setBrush(color);
-            painter.setPen(Qt::NoPen); // Убираем контур, чтобы не было видно линий сетки
-            painter.drawPolygon(polygon);
-        }
-    }
+    ResidualSamples samples = {residual.data(), data, func, dataWidth, dataHeight, a, c, hx, hy};
+    steal_pool_for(&pool, dataHeight - 1, sample_residual, &samples);
     
-    // Update maxValue for info display
-    maxValue = maxVal;
+    double maxResidual = 0.0;
+    for (size_t i = 0; i < residual.size(); i++) {
+        maxResidual = std::max(maxResidual, residual[i]);
+    }
+    maxValue = maxResidual;
 }
 
 void Renderer::calculateMaxValue() {
@@ -793,6 +1011,13 @@ void Renderer::calculateMaxValue() {
         return;
     }
     
+    // Вершина пирамиды -- максимум по всем данным
+    if (dataPyramid.levels > 0 && dataPyramid.level[0].max == data
+        && dataPyramid.level[0].width == dataWidth && dataPyramid.level[0].height == dataHeight) {
+        maxValue = dataPyramid.level[dataPyramid.levels - 1].max[0];
+        return;
+    }
+    
     double max = -INFINITY;
     for (int i = 0; i < dataWidth * dataHeight; i++) {
         max = std::max(max, data[i]);
@@ -802,6 +1027,7 @@ void Renderer::calculateMaxValue() {
 }
 
 void Renderer::setVisualizationDetail(int mx, int my) {
+    resetTiles();
     visualizationWidth = mx;
     visualizationHeight = my;
     update(); // Перерисовка с новой детализацией
@@ -7,33 +7,117 @@
 #include <QPainter>
 #include <QPointF>
 #include <QRectF>
+#include <QImage>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <pthread.h>
+#include <atomic>
+#include <vector>
 #include "function_types.h"
+#include "steal.h"
+#include "raster.h"
+#include "pyramid.h"
+#include "samples.h"
 
 enum class what_to_paint;
 
+// Кэш плиток: на уровне L область [a, b] x [c, d] делится на 2^L x 2^L
+// плиток по TILE_PIXELS x TILE_PIXELS пикселей. Плитки рисует фоновый поток;
+// пока плитки нужного уровня нет, выводится увеличенная часть более грубой.
+#define TILE_PIXELS 256
+#define TILE_CACHE_SIZE 128     // Не меньше 128 плиток по 256 КБ, см. resizeTileCache()
+#define TILE_MAX_LEVEL 20
+#define ZOOM_MAX 65536.0         // Колесо и клавиша 4 не приближают сильнее
+
+// Плитка уточняется проходами: решётка в 8, 4, 2 раза реже нужной, затем
+// полная. Первый проход всех видимых плиток идёт раньше второго, поэтому вид
+// сразу заполняется грубой картинкой. Шкала цветов функции сначала
+// оценивается по сетке RANGE_PREVIEW x RANGE_PREVIEW, затем по mx x my.
+// Выборки по сетке идут полосами не меньше TILE_BAND_ROWS строк, между
+// полосами фоновый поток проверяет, не устарело ли поколение кэша. Полоса
+// растёт с пулом, чтобы каждому потоку досталось STEAL_CHUNKS кусков
+#define TILE_PASSES 4
+#define RANGE_PREVIEW 33
+#define TILE_BAND_ROWS 64
+
+struct Tile {
+    int level;
+    int tx, ty;
+    what_to_paint mode;
+    int cellsX, cellsY;             // Решётка прохода, которым плитка нарисована
+    unsigned int rangeStamp;        // Шкала цветов, с которой она нарисована
+    unsigned long long generation;  // Поколение кэша, в котором плитка нарисована
+    unsigned long long used;        // Отметка последнего вывода, для вытеснения
+    QImage image;
+};
+
+struct TileRequest {
+    int level;
+    int tx, ty;
+    int cellsX, cellsY;
+};
+
+// Всё, что фоновый поток читает при рисовании плитки; копируется под мьютексом
+struct TileScene {
+    what_to_paint mode;
+    double (*func)(double, double);
+    const double *data;
+    int dataWidth, dataHeight;
+    double a, b, c, d;
+    int mx, my;                 // Детализация визуализации
+    int cellsX, cellsY;         // Ячеек на плитку в последнем проходе
+    const double *residualField;
+    double residualMax;
+    unsigned long long generation;
+};
+
+// Шкала цветов режима, общая для всех плиток поколения
+struct ColorRange {
+    bool ready;
+    bool exact;         // По всей сетке mx x my, а не по предварительной
+    unsigned int stamp; // Меняется вместе с field.min и field.max
+    FieldRange field;
+};
+
 class Renderer : public QWidget {
     Q_OBJECT
 
 public:
     Renderer(QWidget *parent = nullptr);
-    
+    ~Renderer();
+
     // Set data and parameters
-    void setData(double *data, int width, int height);
+    void setData(double *data, int width, int height, unsigned long long version);
+    void setResidualField(const double *field, int width, int height, double maxResidual,
+                          unsigned long long version);
     void setBoundaries(double a, double b, double c, double d);
-    void setZoom(double factor, QPointF center = QPointF());
+    void setZoom(double factor);
+    void resetView();
     void setRenderMode(what_to_paint mode);
     void setFunction(double (*f)(double, double));
     void setApproximation(double *approx, int width, int height);
     void setVisualizationDetail(int mx, int my);
-    
+
+    // Таблицы цветов режимов без виджета, для пакетной отрисовки
+    static void colorTables(ColorLut *standard, ColorLut *residual);
+
     double getMaxValue() const;
+    double getZoom() const;
     QPointF l2g(double x, double y) const;
     QPointF g2l(double x, double y) const;
     // QPointF g2l(double x, double y) const;
 
+signals:
+    void viewChanged();         // Масштаб или центр изменены мышью
+    void framePainted(bool complete);   // Кадр выведен; complete -- все плитки окончательные
+
 protected:
     void paintEvent(QPaintEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
 
 private:
     // Data
@@ -43,33 +127,86 @@ private:
     int visualizationWidth;      // Visualization grid width
     int visualizationHeight;     // Visualization grid height
     double maxValue;             // Maximum value for scaling
-    
+
     // Boundaries
     double a, b, c, d;           // Logical boundaries
-    
-    // Zoom
+
+    // Zoom and pan
     double zoomFactor;           // Current zoom factor
-    QPointF zoomCenter;          // Center of zoom
+    QPointF viewCenter;          // Center of the view in logical coordinates
     QRectF visibleRect;          // Currently visible rectangle in logical coordinates
-    
+    bool dragging;               // Перетаскивание левой кнопкой мыши
+    QPoint dragStart;
+    QPointF dragCenter;
+
     // Visualization
     what_to_paint mode;          // Current visualization mode
     double (*func)(double, double); // Original function
-    
+
+    // Выборки значений на сетке визуализации считаются пулом потоков
+    StealPool pool;
+
+    // Версия данных от окна: растёт при каждом новом расчёте
+    unsigned long long dataVersion;
+
+    // Погрешность по ячейкам, посчитанная решателем вместе с r1, и её максимум
+    const double *residualField;
+    int residualWidth, residualHeight;
+    double residualMax;
+    unsigned long long residualVersion;
+
+    // Пирамиды min/max/среднего для отдалённых кадров: данных строится в
+    // setData, погрешности -- фоновым потоком вместе со шкалой цветов
+    Pyramid dataPyramid;
+    Pyramid residualPyramid;
+    std::vector<double> residualSampled;    // Поле погрешности, если решатель его не дал
+
+    // Кэш плиток и фоновый поток; поля ниже защищены tileMutex
+    std::vector<Tile> tiles;
+    std::atomic<unsigned long long> tileGeneration;    // Читается без мьютекса для отмены
+    unsigned long long tileClock;
+    std::vector<TileRequest> tileRequests;
+    TileScene scene;
+    ColorRange ranges[3];
+    bool tileBusy;
+    TileRequest tileCurrent;     // Плитка, которую рисует фоновый поток
+    bool tileStop;
+    pthread_t tileThread;
+    StealPool tilePool;
+    mutable pthread_mutex_t tileMutex;
+    pthread_cond_t tileWake;
+    pthread_cond_t tileIdle;
+
     // Colors and gradients
     QLinearGradient standardGradient;    // Standard gradient (blue-green-red)
     QLinearGradient residualGradient;    // Residual gradient (green-purple)
     QLinearGradient approximationGradient; // Approximation gradient (cyan-orange)
-    
+    ColorLut standardLut;                // Таблицы цветов, запечённые в setupGradients
+    ColorLut residualLut;
+
     // Private methods
     void updateVisibleRect();
     void setupGradients();
-    QColor getColor(double value, double min, double max);
+    static void makeGradients(QLinearGradient &standard, QLinearGradient &residual, QLinearGradient &approximation);
     void drawGrid(QPainter &painter);
-    void drawData(QPainter &painter);
-    void drawResidual(QPainter &painter);
-    void drawFunction(QPainter &painter);
     void calculateMaxValue();
+    void calculateMaxResidual();
+    bool hasResidualField() const;
+
+    // Плитки
+    int tileLevel() const;
+    bool tileRange(int level, int *tx1, int *tx2, int *ty1, int *ty2) const;
+    QRectF tileRect(int level, int tx, int ty) const;
+    Tile *findTile(int level, int tx, int ty, what_to_paint mode);
+    void storeTile(const TileRequest &request, what_to_paint mode, unsigned int rangeStamp, QImage &image);
+    void resetTiles();
+    void resizeTileCache();
+    bool rangePending() const;
+    void tileLoop();
+    bool sampleBands(unsigned long long generation, int rows, void (*fn)(void *, int, int), void *ctx);
+    bool computeRange(const TileScene &s, int mx, int my, ColorRange *range);
+    bool renderTile(const TileScene &s, const ColorRange &range, const TileRequest &request, QImage &image);
+    static void *tileWorker(void *ptr);
 };
 
-#endif // RENDERER_HPP 
\ No newline at end of file
+#endif // RENDERER_HPP
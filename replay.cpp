@@ -0,0 +1,207 @@
+#include "replay.hpp"
+#include "window.hpp"
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+Replay::Replay(MainWindow *window, const std::vector<int> &keys, const char *reportPath,
+               int timeoutMs, QObject *parent)
+    : QObject(parent), window(window), keys(keys), reportPath(reportPath), next(0),
+      active(false), solving(false), pressed(0.0), renderFrom(0.0) {
+    watchdog.setSingleShot(true);
+    watchdog.setInterval(timeoutMs);
+    connect(&watchdog, &QTimer::timeout, this, &Replay::actionTimeout);
+    connect(window, &MainWindow::computationFinished, this, &Replay::computationFinished);
+    connect(window->getRenderer(), &Renderer::framePainted, this, &Replay::framePainted);
+}
+
+double Replay::now() const {
+    return clock.nsecsElapsed() * 1e-6;
+}
+
+// Первое действие -- запуск окна: начальный расчёт и первый полный кадр
+void Replay::start() {
+    clock.start();
+    current = {-1, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0, false};
+    pressed = 0.0;
+    solving = window->isRunning();
+    renderFrom = 0.0;
+    active = true;
+    watchdog.start();
+    window->getRenderer()->update();
+}
+
+void Replay::nextKey() {
+    if (next == keys.size()) {
+        finish();
+        return;
+    }
+
+    const int key = keys[next++];
+    current = {key, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0, false};
+    pressed = now();
+
+    QKeyEvent event(QEvent::KeyPress, key, Qt::NoModifier, QString(QChar('0' + key - Qt::Key_0)));
+    QCoreApplication::sendEvent(window, &event);
+
+    const double handled = now();
+    current.handle = handled - pressed;
+    solving = window->isRunning();
+    renderFrom = handled;
+    active = true;
+    watchdog.start();
+
+    // Клавиша могла ничего не изменить (предел масштаба или детализации):
+    // тогда кадр -- просто перерисовка из кэша плиток
+    window->getRenderer()->update();
+}
+
+void Replay::computationFinished() {
+    if (!active || !solving) {
+        return;
+    }
+    solving = false;
+    renderFrom = now();
+
+    // Расчёт стартует внутри keyPressEvent; остаток до renderFrom -- ожидание таймера окна
+    current.solve = window->lastSolveTime() * 1e3;
+    current.wait = std::max(renderFrom - pressed - current.handle - current.solve, 0.0);
+}
+
+// Кадры, выведенные во время расчёта, показывают старые данные и не считаются
+void Replay::framePainted(bool complete) {
+    if (!active || solving) {
+        return;
+    }
+
+    const double t = now();
+    current.frames++;
+    if (current.first < 0.0) {
+        current.first = t - pressed;
+    }
+    if (complete) {
+        current.render = t - renderFrom;
+        current.total = t - pressed;
+        finishAction(false);
+    }
+}
+
+void Replay::actionTimeout() {
+    if (!active) {
+        return;
+    }
+
+    const double t = now();
+    current.render = solving ? 0.0 : t - renderFrom;
+    current.total = t - pressed;
+    if (solving) {
+        current.solve = t - pressed - current.handle;
+    }
+
+    // Пока идёт расчёт, окно не принимает клавиши: сценарий прерывается
+    if (solving) {
+        next = keys.size();
+    }
+    finishAction(true);
+}
+
+// Следующая клавиша -- после возврата в цикл событий, не изнутри paintEvent
+void Replay::finishAction(bool timedOut) {
+    watchdog.stop();
+    active = false;
+    current.timedOut = timedOut;
+    actions.push_back(current);
+    QTimer::singleShot(0, this, &Replay::nextKey);
+}
+
+void Replay::finish() {
+    int timeouts = 0;
+    for (size_t i = 0; i < actions.size(); i++) {
+        timeouts += actions[i].timedOut ? 1 : 0;
+    }
+
+    const int res = writeReport();
+    QCoreApplication::exit(res != 0 || timeouts > 0 ? 1 : 0);
+}
+
+static const char *key_name(int key, char *buf) {
+    if (key < 0) {
+        return "start";
+    }
+    buf[0] = (char)('0' + key - Qt::Key_0);
+    buf[1] = '\0';
+    return buf;
+}
+
+// Таблица действий в stdout, по запросу -- CSV с теми же столбцами
+int Replay::writeReport() const {
+    char name[2];
+
+    printf("%4s %5s %10s %10s %10s %10s %10s %10s %6s\n",
+           "#", "key", "handle_ms", "solve_ms", "wait_ms", "render_ms", "first_ms", "total_ms", "frames");
+    std::vector<double> totals;
+    for (size_t i = 0; i < actions.size(); i++) {
+        const ReplayAction &r = actions[i];
+        printf("%4zu %5s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %6d%s\n",
+               i, key_name(r.key, name), r.handle, r.solve, r.wait, r.render, r.first, r.total, r.frames,
+               r.timedOut ? "  timeout" : "");
+        if (r.key >= 0 && !r.timedOut) {
+            totals.push_back(r.total);
+        }
+    }
+    if (!totals.empty()) {
+        std::sort(totals.begin(), totals.end());
+        printf("Replay: %zu keys, total median %.2f ms, max %.2f ms\n",
+               totals.size(), totals[totals.size() / 2], totals.back());
+    }
+    fflush(stdout);
+
+    if (reportPath == nullptr) {
+        return 0;
+    }
+
+    FILE *fp = fopen(reportPath, "w");
+    if (fp == nullptr) {
+        fprintf(stderr, "Error: Cannot open replay report %s.\n", reportPath);
+        return 1;
+    }
+    fprintf(fp, "index,key,handle_ms,solve_ms,wait_ms,render_ms,first_ms,total_ms,frames,timeout\n");
+    for (size_t i = 0; i < actions.size(); i++) {
+        const ReplayAction &r = actions[i];
+        fprintf(fp, "%zu,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d\n",
+                i, key_name(r.key, name), r.handle, r.solve, r.wait, r.render, r.first, r.total, r.frames,
+                r.timedOut ? 1 : 0);
+    }
+    return fclose(fp) == 0 ? 0 : 1;
+}
+
+// Клавиши 0-9 через пробелы и переводы строк, # -- комментарий до конца
+// строки. Возвращает -1, если файл не открылся, или номер строки с ошибкой
+int read_replay_script(const char *path, std::vector<int> *keys) {
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    char line[4096];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        line_no++;
+        line[strcspn(line, "#")] = '\0';
+
+        char *save = nullptr;
+        for (char *token = strtok_r(line, " \t\r\n", &save); token != nullptr;
+             token = strtok_r(nullptr, " \t\r\n", &save)) {
+            if (token[0] < '0' || token[0] > '9' || token[1] != '\0') {
+                fclose(fp);
+                return line_no;
+            }
+            keys->push_back(Qt::Key_0 + (token[0] - '0'));
+        }
+    }
+    fclose(fp);
+
+    return 0;
+}
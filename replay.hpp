@@ -0,0 +1,73 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <vector>
+
+class MainWindow;
+
+// Повтор сценария клавиш 0-9 с замером задержки до кадра. Клавиша
+// отправляется окну событием QKeyEvent и попадает в MainWindow::keyPressEvent,
+// как от пользователя; следующая нажимается, когда после предыдущей выведен
+// окончательный кадр. Обычно запускается с QT_QPA_PLATFORM=offscreen.
+//
+// Времена в мс: handle -- сам keyPressEvent (расчёт он только запускает в
+// потоках), solve -- расчёт, запущенный клавишей, по часам потоков расчёта,
+// wait -- от конца расчёта до того, как окно заметит его по таймеру 50 мс.
+// От нажатия: first -- первый кадр после обработки или расчёта, total --
+// окончательный кадр. render -- от конца обработки или от того, как окно
+// заметило конец расчёта, до окончательного кадра. Расчёт идёт в p потоках,
+// создаваемых заново для каждого запуска, так что p > 1 допустимо.
+struct ReplayAction {
+    int key;                // Qt::Key_0 ... Qt::Key_9, -1 -- запуск окна
+    double handle;
+    double solve;
+    double wait;
+    double first;
+    double render;
+    double total;
+    int frames;             // Кадров до окончательного
+    bool timedOut;
+};
+
+class Replay : public QObject {
+    Q_OBJECT
+
+public:
+    Replay(MainWindow *window, const std::vector<int> &keys, const char *reportPath,
+           int timeoutMs, QObject *parent = nullptr);
+
+    void start();
+
+private slots:
+    void nextKey();
+    void computationFinished();
+    void framePainted(bool complete);
+    void actionTimeout();
+
+private:
+    MainWindow *window;
+    std::vector<int> keys;
+    const char *reportPath;     // CSV, nullptr -- только таблица в stdout
+    size_t next;                // Следующая клавиша сценария
+
+    QElapsedTimer clock;
+    QTimer watchdog;            // Предел ожидания окончательного кадра
+    std::vector<ReplayAction> actions;
+    ReplayAction current;
+    bool active;                // Действие нажато, окончательный кадр не выведен
+    bool solving;
+    double pressed;             // Отметки текущего действия, мс от clock
+    double renderFrom;
+
+    double now() const;
+    void finishAction(bool timedOut);
+    void finish();
+    int writeReport() const;
+};
+
+int read_replay_script(const char *path, std::vector<int> *keys);
+
+#endif // REPLAY_HPP
@@ -1,42 +1,61 @@
 #include "all_includes.h"
 #include <algorithm>
 
-double r1(int nx, int ny, double a, double c, double hx, double hy, double* x, double (*f)(double, double), int p, int k) {
+// Проходы r1-r4 идут кусками с перехватом (см. steal.h): поток, закончивший
+// свою часть, забирает куски у отстающих. Суммы r2 и r4 копятся по кускам и
+// складываются в порядке узлов, поэтому не зависят от распределения кусков.
+
+// cells != nullptr: заодно поле погрешности по ячейкам в естественном порядке,
+// cells[j * nx + i] -- максимум по двум треугольникам ячейки (i, j)
+double r1(int nx, int ny, double a, double c, double hx, double hy, double* x, double (*f)(double, double), int p, int k,
+          double* cells) {
+    PROFILE_SCOPE(PHASE_RESIDUAL);
     const int gridSize = (nx+1) * (ny+1);
-    int startIdx, endIdx;
+    int startIdx, endIdx, chunk;
     int rowIdx, colIdx;
     
-    thread_rows(gridSize, p, k, startIdx, endIdx);
+    StealLoop loop;
+    steal_begin(&loop, node_work::triangles, gridSize, p, k);
     
     double maxError = -1;
     
-    for (int idx = startIdx; idx < endIdx; ++idx) {
-        l2ij(nx, ny, rowIdx, colIdx, idx);
+    while (steal_next(&loop, startIdx, endIdx, chunk)) {
+        for (int idx = startIdx; idx < endIdx; ++idx) {
+            l2ij(nx, ny, rowIdx, colIdx, idx);
 
-        if (rowIdx == nx || colIdx == ny) {
-            continue;
-        }
+            if (rowIdx == nx || colIdx == ny) {
+                continue;
+            }
 
-        const double x1 = a + (rowIdx + 2.0/3.0) * hx;
-        const double y1 = c + (colIdx + 1.0/3.0) * hy;
-        const double x2 = a + (rowIdx + 1.0/3.0) * hx;
-        const double y2 = c + (colIdx + 2.0/3.0) * hy;
-        
-        const double node1 = x[idx];
-        const double node2 = x[idx + 1];
-        const double node3 = x[idx + 1 + nx + 1];
-        const double node4 = x[idx + nx + 1];
-        
-        const double exactVal1 = f(x1, y1);
-        const double approxVal1 = (node1 + node2 + node3) / 3.0;
-        const double error1 = fabs(exactVal1 - approxVal1);
-        
-        const double exactVal2 = f(x2, y2);
-        const double approxVal2 = (node1 + node4 + node3) / 3.0;
-        const double error2 = fabs(exactVal2 - approxVal2);
-        
-        const double localMax = std::max(error1, error2);
-        maxError = std::max(maxError, localMax);
+            const double x1 = a + (rowIdx + 2.0/3.0) * hx;
+            const double y1 = c + (colIdx + 1.0/3.0) * hy;
+            const double x2 = a + (rowIdx + 1.0/3.0) * hx;
+            const double y2 = c + (colIdx + 2.0/3.0) * hy;
+            
+            int right, diag, top;
+            ij2l(nx, ny, rowIdx + 1, colIdx, right);
+            ij2l(nx, ny, rowIdx + 1, colIdx + 1, diag);
+            ij2l(nx, ny, rowIdx, colIdx + 1, top);
+
+            const double node1 = x[idx];
+            const double node2 = x[right];
+            const double node3 = x[diag];
+            const double node4 = x[top];
+            
+            const double exactVal1 = f(x1, y1);
+            const double approxVal1 = (node1 + node2 + node3) / 3.0;
+            const double error1 = fabs(exactVal1 - approxVal1);
+            
+            const double exactVal2 = f(x2, y2);
+            const double approxVal2 = (node1 + node4 + node3) / 3.0;
+            const double error2 = fabs(exactVal2 - approxVal2);
+            
+            const double localMax = std::max(error1, error2);
+            maxError = std::max(maxError, localMax);
+            if (cells != nullptr) {
+                cells[(size_t)colIdx * nx + rowIdx] = localMax;
+            }
+        }
     }
 
     reduce_sum(p, &maxError, 1, &max);
@@ -45,59 +64,74 @@ double r1(int nx, int ny, double a, double c, double hx, double hy, double* x, d
 }
 
 double r2(int nx, int ny, double a, double c, double hx, double hy, double* x, double (*f)(double, double), int p, int k) {
+    PROFILE_SCOPE(PHASE_RESIDUAL);
     const int gridSize = (nx+1) * (ny+1);
-    int startIdx, endIdx;
+    int startIdx, endIdx, chunk;
     int rowIdx, colIdx;
     
-    thread_rows(gridSize, p, k, startIdx, endIdx);
-    
-    double errorSum = 0.0;
+    StealLoop loop;
+    steal_begin(&loop, node_work::triangles, gridSize, p, k);
     
-    for (int idx = startIdx; idx < endIdx; ++idx) {
-        l2ij(nx, ny, rowIdx, colIdx, idx);
+    while (steal_next(&loop, startIdx, endIdx, chunk)) {
+        double errorSum = 0.0;
         
-        if (rowIdx == nx || colIdx == ny) {
-            continue;
-        }
+        for (int idx = startIdx; idx < endIdx; ++idx) {
+            l2ij(nx, ny, rowIdx, colIdx, idx);
+            
+            if (rowIdx == nx || colIdx == ny) {
+                continue;
+            }
 
-        const double px1 = a + (rowIdx + 2.0/3.0) * hx;
-        const double py1 = c + (colIdx + 1.0/3.0) * hy;
-        const double px2 = a + (rowIdx + 1.0/3.0) * hx;
-        const double py2 = c + (colIdx + 2.0/3.0) * hy;
-        
-        const double valAtNode = x[idx];
-        const double valAtRightNode = x[idx + 1];
-        const double valAtDiagNode = x[idx + 1 + nx + 1];
-        const double valAtTopNode = x[idx + nx + 1];
-        
-        const double triangleError1 = fabs(f(px1, py1) - (valAtNode + valAtRightNode + valAtDiagNode) / 3.0);
-        const double triangleError2 = fabs(f(px2, py2) - (valAtNode + valAtTopNode + valAtDiagNode) / 3.0);
+            const double px1 = a + (rowIdx + 2.0/3.0) * hx;
+            const double py1 = c + (colIdx + 1.0/3.0) * hy;
+            const double px2 = a + (rowIdx + 1.0/3.0) * hx;
+            const double py2 = c + (colIdx + 2.0/3.0) * hy;
+            
+            int right, diag, top;
+            ij2l(nx, ny, rowIdx + 1, colIdx, right);
+            ij2l(nx, ny, rowIdx + 1, colIdx + 1, diag);
+            ij2l(nx, ny, rowIdx, colIdx + 1, top);
+
+            const double valAtNode = x[idx];
+            const double valAtRightNode = x[right];
+            const double valAtDiagNode = x[diag];
+            const double valAtTopNode = x[top];
+            
+            const double triangleError1 = fabs(f(px1, py1) - (valAtNode + valAtRightNode + valAtDiagNode) / 3.0);
+            const double triangleError2 = fabs(f(px2, py2) - (valAtNode + valAtTopNode + valAtDiagNode) / 3.0);
+            
+            errorSum += triangleError1 + triangleError2;
+        }
         
-        errorSum += triangleError1 + triangleError2;
+        steal_partial(&loop, chunk, errorSum);
     }
 
-    // Combine results from all threads
-    double totalError = reduce_sum_det(p, k, errorSum);
+    // Combine results from all chunks
+    double totalError = steal_sum(&loop);
     return (hx * hy * totalError) / 2.0;
 }
 
 double r3(int nx, int ny, double a, double c, double hx, double hy, double* x, double (*f)(double, double), int p, int k) {
+    PROFILE_SCOPE(PHASE_RESIDUAL);
     const int gridSize = (nx+1) * (ny+1);
-    int startIdx, endIdx;
+    int startIdx, endIdx, chunk;
     int rowIdx, colIdx;
     
-    thread_rows(gridSize, p, k, startIdx, endIdx);
+    StealLoop loop;
+    steal_begin(&loop, node_work::nodes, gridSize, p, k);
     
     double nodeMaxError = -1.0;
     
-    for (int nodeIdx = startIdx; nodeIdx < endIdx; ++nodeIdx) {
-        l2ij(nx, ny, rowIdx, colIdx, nodeIdx);
-        
-        const double exactValue = f(a + rowIdx*hx, c + colIdx*hy);
-        const double approxValue = x[nodeIdx];
-        
-        const double nodeError = fabs(exactValue - approxValue);
-        nodeMaxError = std::max(nodeMaxError, nodeError);
+    while (steal_next(&loop, startIdx, endIdx, chunk)) {
+        for (int nodeIdx = startIdx; nodeIdx < endIdx; ++nodeIdx) {
+            l2ij(nx, ny, rowIdx, colIdx, nodeIdx);
+            
+            const double exactValue = f(a + rowIdx*hx, c + colIdx*hy);
+            const double approxValue = x[nodeIdx];
+            
+            const double nodeError = fabs(exactValue - approxValue);
+            nodeMaxError = std::max(nodeMaxError, nodeError);
+        }
     }
 
     reduce_sum(p, &nodeMaxError, 1, &max);
@@ -106,23 +140,30 @@ double r3(int nx, int ny, double a, double c, double hx, double hy, double* x, d
 }
 
 double r4(int nx, int ny, double a, double c, double hx, double hy, double* x, double (*f)(double, double), int p, int k) {
+    PROFILE_SCOPE(PHASE_RESIDUAL);
     const int gridSize = (nx+1) * (ny+1);
-    int startIdx, endIdx;
+    int startIdx, endIdx, chunk;
     int rowIdx, colIdx;
     
-    thread_rows(gridSize, p, k, startIdx, endIdx);
-    double errorAccumulator = 0.0;
+    StealLoop loop;
+    steal_begin(&loop, node_work::nodes, gridSize, p, k);
     
-    for (int nodeIdx = startIdx; nodeIdx < endIdx; ++nodeIdx) {
-        l2ij(nx, ny, rowIdx, colIdx, nodeIdx);
+    while (steal_next(&loop, startIdx, endIdx, chunk)) {
+        double errorAccumulator = 0.0;
         
-        const double physX = a + rowIdx * hx;
-        const double physY = c + colIdx * hy;
+        for (int nodeIdx = startIdx; nodeIdx < endIdx; ++nodeIdx) {
+            l2ij(nx, ny, rowIdx, colIdx, nodeIdx);
+            
+            const double physX = a + rowIdx * hx;
+            const double physY = c + colIdx * hy;
+            
+            errorAccumulator += fabs(f(physX, physY) - x[nodeIdx]);
+        }
         
-        errorAccumulator += fabs(f(physX, physY) - x[nodeIdx]);
+        steal_partial(&loop, chunk, errorAccumulator);
     }
 
-    double totalError = reduce_sum_det(p, k, errorAccumulator);
+    double totalError = steal_sum(&loop);
     
     return hx * hy * totalError;
 }
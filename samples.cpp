@@ -0,0 +1,165 @@
+#include "samples.h"
+#include <cmath>
+#include <algorithm>
+
+void sample_function(void *ptr, int j1, int j2) {
+    FunctionSamples *s = (FunctionSamples *)ptr;
+    for (int j = j1; j < j2; j++) {
+        for (int i = 0; i < s->nx; i++) {
+            double x = s->left + s->width * i / (s->nx - 1);
+            double y = s->top + s->height * j / (s->ny - 1);
+            s->values[j * s->nx + i] = s->func(x, y);
+        }
+    }
+}
+
+void sample_range(void *ptr, int j1, int j2) {
+    FunctionRange *s = (FunctionRange *)ptr;
+    for (int j = j1; j < j2; j++) {
+        double minVal = INFINITY;
+        double maxVal = -INFINITY;
+        for (int i = 0; i < s->nx; i++) {
+            double x = s->left + s->width * i / (s->nx - 1);
+            double y = s->top + s->height * j / (s->ny - 1);
+            double value = s->func(x, y);
+            minVal = std::min(minVal, value);
+            maxVal = std::max(maxVal, value);
+        }
+        s->rowMin[j] = minVal;
+        s->rowMax[j] = maxVal;
+    }
+}
+
+void sample_data(void *ptr, int j1, int j2) {
+    DataSamples *s = (DataSamples *)ptr;
+    for (int j = j1; j < j2; j++) {
+        for (int i = 0; i < s->nx; i++) {
+            // Преобразуем индексы сетки визуализации в координаты области
+            double x = s->left + s->width * i / (s->nx - 1);
+            double y = s->top + s->height * j / (s->ny - 1);
+            
+            // Находим соответствующую ячейку в исходной сетке данных
+            double relX = (x - s->a) / (s->b - s->a);
+            double relY = (y - s->c) / (s->d - s->c);
+            
+            if (relX < 0) relX = 0;
+            if (relX > 1) relX = 1;
+            if (relY < 0) relY = 0;
+            if (relY > 1) relY = 1;
+            
+            double dataX = relX * (s->dataWidth - 1);
+            double dataY = relY * (s->dataHeight - 1);
+            
+            // Билинейная интерполяция средних по блокам уровня
+            s->values[j * s->nx + i] = pyramid_mean(s->pyramid, s->level, dataX, dataY);
+        }
+    }
+}
+
+// Погрешность по ТЗ на исходной сетке: максимум по двум треугольникам ячейки,
+// residual[j * (dataWidth - 1) + i]
+void sample_residual(void *ptr, int j1, int j2) {
+    ResidualSamples *s = (ResidualSamples *)ptr;
+    const int w = s->dataWidth;
+    for (int j = j1; j < j2; j++) {
+        for (int i = 0; i < w - 1; i++) {
+            // Получение значений в узлах
+            double node1 = s->data[j * w + i]; // (i,j)
+            double node2 = s->data[j * w + i + 1]; // (i+1,j)
+            double node3 = s->data[(j + 1) * w + i + 1]; // (i+1,j+1)
+            double node4 = s->data[(j + 1) * w + i]; // (i,j+1)
+            
+            // Нижний треугольник - точка с координатами (i+2/3, j+1/3)
+            double exact_low = s->func(s->a + s->hx * (i + 2.0/3.0), s->c + s->hy * (j + 1.0/3.0));
+            double residual_low = std::fabs(exact_low - (node1 + node2 + node3) / 3.0);
+            
+            // Верхний треугольник - точка с координатами (i+1/3, j+2/3)
+            double exact_up = s->func(s->a + s->hx * (i + 1.0/3.0), s->c + s->hy * (j + 2.0/3.0));
+            double residual_up = std::fabs(exact_up - (node1 + node3 + node4) / 3.0);
+            
+            s->residual[j * (w - 1) + i] = std::max(residual_low, residual_up);
+        }
+    }
+}
+
+void sample_cells(void *ptr, int j1, int j2) {
+    CellSamples *s = (CellSamples *)ptr;
+    for (int j = j1; j < j2; j++) {
+        for (int i = 0; i < s->nx; i++) {
+            double x = s->left + s->width * i / (s->nx - 1);
+            double y = s->top + s->height * j / (s->ny - 1);
+            
+            int dataX = static_cast<int>((x - s->a) / s->hx);
+            int dataY = static_cast<int>((y - s->c) / s->hy);
+            dataX = std::min(std::max(dataX, 0), s->cellsX - 1);
+            dataY = std::min(std::max(dataY, 0), s->cellsY - 1);
+            
+            s->values[j * s->nx + i] = pyramid_max(s->pyramid, s->level, dataX, dataY);
+        }
+    }
+}
+
+// Псевдоградиент по координатам области для константных полей; считается
+// от [a, b] x [c, d], поэтому соседние плитки стыкуются
+void pseudo_gradient(double *values, int nx, int ny, double left, double top,
+                     double width, double height, double a, double b, double c, double d) {
+    for (int j = 0; j < ny; j++) {
+        for (int i = 0; i < nx; i++) {
+            double relX = (left + width * i / (nx - 1) - a) / (b - a);
+            double relY = (top + height * j / (ny - 1) - c) / (d - c);
+            
+            // Создаем интересный паттерн на основе координат
+            values[j * nx + i] = relX * relY + (1 - relX) * (1 - relY);
+        }
+    }
+}
+
+// Все значения в пределах eps от value -- поле константное
+static void field_range(double minVal, double maxVal, double value, double eps, FieldRange *range) {
+    if (!(maxVal - value > eps) && !(value - minVal > eps)) {
+        range->min = 0.0;
+        range->max = 1.0;
+        range->constOne = std::fabs(value - 1.0) < eps;
+        range->pseudo = !range->constOne;
+    } else {
+        range->min = minVal;
+        range->max = maxVal;
+        range->pseudo = false;
+        range->constOne = false;
+    }
+}
+
+// Функция: минимум и максимум по сетке и значение в углу (a, c)
+void function_range(double minVal, double maxVal, double corner, FieldRange *range) {
+    field_range(minVal, maxVal, corner, 1e-6, range);
+}
+
+// Данные: вершина пирамиды -- минимум и максимум по всем узлам
+void data_range(const Pyramid *pyramid, FieldRange *range) {
+    const PyramidLevel *top = &pyramid->level[pyramid->levels - 1];
+    field_range(top->min[0], top->max[0], top->min[0], 1e-16, range);
+}
+
+// Погрешность: нулевая попадает в начало шкалы (зеленый цвет)
+void residual_range(double maxResidual, FieldRange *range) {
+    range->min = 0.0;
+    range->max = maxResidual;
+    range->pseudo = false;
+    range->constOne = false;
+}
+
+// Значения константного поля перед растеризацией, остальные не трогаются
+void constant_fill(const FieldRange *range, double *values, int nx, int ny, double left, double top,
+                   double width, double height, double a, double b, double c, double d) {
+    if (range->constOne) {
+        std::fill(values, values + (size_t)nx * ny, 0.5); // Зеленый цвет в градиенте
+    } else if (range->pseudo) {
+        pseudo_gradient(values, nx, ny, left, top, width, height, a, b, c, d);
+    }
+}
+
+// Уровень пирамиды, блок которого не больше шага выборки: spanX x spanY
+// узлов или ячеек данных на cellsX x cellsY ячеек решётки
+int sample_level(const Pyramid *pyramid, double spanX, double spanY, double cellsX, double cellsY) {
+    return pyramid_level(pyramid, std::min(spanX / cellsX, spanY / cellsY));
+}
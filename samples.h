@@ -0,0 +1,83 @@
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include "pyramid.h"
+
+// Выборки значений поля в узлах решётки nx x ny, растянутой на
+// прямоугольник [left, left + width] x [top, top + height] логической
+// области. Функции -- куски для steal_pool_for: каждый кусок -- диапазон
+// строк j решётки, значения хранятся построчно, values[j * nx + i]. Общие для
+// плиток renderer и пакетной отрисовки в файлы.
+
+struct FunctionSamples {
+    double *values;
+    double (*func)(double, double);
+    double left, top, width, height;
+    int nx, ny;
+};
+
+// Минимум и максимум функции по строкам сетки, без хранения самих значений:
+// при большой детализации сетка mx x my не помещается в память
+struct FunctionRange {
+    double *rowMin, *rowMax;
+    double (*func)(double, double);
+    double left, top, width, height;
+    int nx, ny;
+};
+
+// Значения берутся из уровня level пирамиды данных; уровень 0 -- сами данные
+struct DataSamples {
+    double *values;
+    const Pyramid *pyramid;
+    int level;
+    int dataWidth, dataHeight;
+    double a, b, c, d;
+    double left, top, width, height;
+    int nx, ny;
+};
+
+// Погрешность на исходной сетке данных, куски -- строки ячеек
+struct ResidualSamples {
+    double *residual;
+    const double *data;
+    double (*func)(double, double);
+    int dataWidth, dataHeight;
+    double a, c, hx, hy;
+};
+
+// Погрешность в узлах решётки: максимум по блоку ячеек данных, в который
+// попадает узел; блок берётся из уровня level пирамиды погрешности
+struct CellSamples {
+    double *values;
+    const Pyramid *pyramid;
+    int level;
+    int cellsX, cellsY;
+    double a, c, hx, hy;
+    double left, top, width, height;
+    int nx, ny;
+};
+
+// Шкала цветов поля. Константное поле рисуется по шкале [0, 1]: константа
+// 1 -- однородным средним цветом, другие -- псевдоградиентом по координатам
+struct FieldRange {
+    double min, max;
+    bool pseudo;
+    bool constOne;
+};
+
+void sample_function(void *ptr, int j1, int j2);
+void sample_range(void *ptr, int j1, int j2);
+void sample_data(void *ptr, int j1, int j2);
+void sample_residual(void *ptr, int j1, int j2);
+void sample_cells(void *ptr, int j1, int j2);
+void pseudo_gradient(double *values, int nx, int ny, double left, double top,
+                     double width, double height, double a, double b, double c, double d);
+
+void function_range(double minVal, double maxVal, double corner, FieldRange *range);
+void data_range(const Pyramid *pyramid, FieldRange *range);
+void residual_range(double maxResidual, FieldRange *range);
+void constant_fill(const FieldRange *range, double *values, int nx, int ny, double left, double top,
+                   double width, double height, double a, double b, double c, double d);
+int sample_level(const Pyramid *pyramid, double spanX, double spanY, double cellsX, double cellsY);
+
+#endif // SAMPLES_H
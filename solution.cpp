@@ -1,10 +1,10 @@
 #include <sys/sysinfo.h>
 #include "all_includes.h"
 
-void* solution(void* ptr) {
-    Args* args = (Args*)ptr;
+template <class index_t>
+static void solve(Args* args, index_t* I) {
     double a = args->a; double b = args->b; double c = args->c; double d = args->d;
-    double eps = args->eps; int* I = args->I; double* A = args->A; double* B = args->B;
+    double eps = args->eps; double* A = args->A; double* B = args->B;
     double* x = args->x; double* r = args->r; double* u = args->u; double* v = args->v;
     int maxit = args->maxit; int nx = args->nx; int ny = args->ny;
     int p = args->p; int k = args->k; double (*f)(double, double) = args->f;
@@ -17,22 +17,37 @@ void* solution(void* ptr) {
     pthread_t tid = pthread_self();
 
     pthread_setaffinity_np(tid, sizeof(cpu), &cpu);
+    profile_thread(k);
 
     double hx = (b - a) / nx;
     double hy = (d - c) / ny;
     int N = (nx + 1) * (ny + 1);
     
+    // Начальное приближение приходит в естественном порядке узлов
+    natural_to_tiled(nx, ny, x, u, p, k);
+
     fill_A(nx, ny, hx, hy, I, A, p, k);
     fill_B(nx, ny, hx, hy, a, c, B, f, p, k); 
 
-    int maxsteps = 300; // гиперпараметр
+    int maxsteps = SOLVER_MAXSTEPS;
     args->t1 = get_cpu_time();
-    int its = minimal_errors_msr_matrix_full(N, A, I, B, x, r, u, v, eps, maxit, maxsteps, p, k);  
+    int its;
+    if (args->sstep > 0) {
+        double* basis[SSTEP_MAX + 1];
+        for (int m = 0; m <= args->sstep; ++m) {
+            basis[m] = args->V + (size_t)m * N;
+        }
+        double* ring = args->ring + (size_t)k * sstep_ring_length(nx, args->sstep);
+        its = ca_minimal_residual_msr_matrix(nx, ny, A, I, B, x, basis, ring, args->sstep, eps, maxit * maxsteps, p, k);
+    } else {
+        its = minimal_errors_msr_matrix_full(N, A, I, B, x, r, u, v, eps, maxit, maxsteps, p, k,
+                                             nx, ny, args->ckpt, args->history);
+    }
     args->t1 = get_cpu_time() - args->t1;
     args->its = its;
 
     args->t2 = get_cpu_time();
-    double res_1 = r1(nx, ny, a, c, hx, hy, x, f, p, k);
+    double res_1 = r1(nx, ny, a, c, hx, hy, x, f, p, k, args->cell_errors);
     double res_2 = r2(nx, ny, a, c, hx, hy, x, f, p, k);
     double res_3 = r3(nx, ny, a, c, hx, hy, x, f, p, k);
     double res_4 = r4(nx, ny, a, c, hx, hy, x, f, p, k);
@@ -43,7 +58,22 @@ void* solution(void* ptr) {
     args->res_3 = res_3;
     args->res_4 = res_4;
 
+    tiled_to_natural(nx, ny, x, u, p, k);
+
+    if (args->node_errors != nullptr || args->triangle_errors != nullptr) {
+        output_errors(nx, ny, a, c, hx, hy, x, f, args->node_errors, args->triangle_errors, p, k);
+    }
+
     reduce_sum<int>(p);
     args->completed = true;
+}
+
+void* solution(void* ptr) {
+    Args* args = (Args*)ptr;
+    if (args->I64 != nullptr) {
+        solve(args, args->I64);
+    } else {
+        solve(args, args->I);
+    }
     return nullptr;
 }
@@ -0,0 +1,222 @@
+#include "all_includes.h"
+
+// Ядро степеней матрицы: V[m] = scale * A * V[m-1], m = 1..s, для узлов плитки потока.
+// Плитка расширяется на s - m узлов для уровня m, недостающие значения соседних плиток
+// пересчитываются локально. Строки обходятся со сдвигом: на шаге Y уровень m считает
+// строку Y - m, поэтому от каждого уровня в кэше живут только три последние строки
+// (кольцевой буфер ring размера s * 3 * ширина расширенной плитки).
+template <class index_t>
+void matrix_powers_msr(int nx, int ny, double* A, index_t* I, double** V, int s, double scale,
+    double* ring, int p, int k) {
+    PROFILE_SCOPE(PHASE_MATVEC);
+    int i1, i2, j1, j2;
+    (void)p;
+    get_tile(k, i1, i2, j1, j2);
+
+    const int ei1 = std::max(i1 - s, 0);
+    const int ej1 = std::max(j1 - s, 0);
+    const int ej2 = std::min(j2 + s, ny + 1);
+    const int ew = std::min(i2 + s, nx + 1) - ei1;
+
+    for (int Y = ej1; Y < ej2 + s; ++Y) {
+        for (int m = 0; m <= s; ++m) {
+            const int y = Y - m;
+            const int grow = s - m;
+            if (y < std::max(j1 - grow, 0) || y >= std::min(j2 + grow, ny + 1)) {
+                continue;
+            }
+            const int ri1 = std::max(i1 - grow, 0);
+            const int ri2 = std::min(i2 + grow, nx + 1);
+            double* out = m < s ? ring + ((size_t)m * 3 + (y - ej1) % 3) * ew : nullptr;
+            int g;
+
+            if (m == 0) {
+                for (int i = ri1; i < ri2; ++i) {
+                    ij2l(nx, ny, i, y, g);
+                    out[i - ei1] = V[0][g];
+                }
+                continue;
+            }
+
+            const bool own_row = y >= j1 && y < j2;
+            const double* prev = ring + (size_t)(m - 1) * 3 * ew;
+
+            for (int i = ri1; i < ri2; ++i) {
+                ij2l(nx, ny, i, y, g);
+                double sum = A[g] * prev[(y - ej1) % 3 * ew + i - ei1];
+                index_t q = I[g];
+                for (int idx = 0; idx < 6; ++idx) {
+                    int ni = i + msr_neighbors[idx][0];
+                    int nj = y + msr_neighbors[idx][1];
+                    if (ni >= 0 && ni <= nx && nj >= 0 && nj <= ny) {
+                        sum += A[q++] * prev[(nj - ej1) % 3 * ew + ni - ei1];
+                    }
+                }
+                sum *= scale;
+
+                if (out) {
+                    out[i - ei1] = sum;
+                }
+                if (own_row && i >= i1 && i < i2) {
+                    V[m][g] = sum;
+                }
+            }
+        }
+    }
+}
+
+// Решение G d = g по Холецкому; при потере положительной определённости
+// используется ведущий блок. Возвращает число использованных векторов базиса.
+static int cholesky_solve(double G[SSTEP_MAX][SSTEP_MAX], double* g, double* d, int s) {
+    double L[SSTEP_MAX][SSTEP_MAX];
+    int used = s;
+
+    for (int j = 0; j < s && used == s; ++j) {
+        double diag = G[j][j];
+        for (int q = 0; q < j; ++q) {
+            diag -= L[j][q] * L[j][q];
+        }
+        if (!(diag > 1e-14 * G[0][0])) {
+            used = j;
+            break;
+        }
+        L[j][j] = sqrt(diag);
+        for (int i = j + 1; i < s; ++i) {
+            double t = G[i][j];
+            for (int q = 0; q < j; ++q) {
+                t -= L[i][q] * L[j][q];
+            }
+            L[i][j] = t / L[j][j];
+        }
+    }
+
+    for (int i = 0; i < used; ++i) {
+        double t = g[i];
+        for (int q = 0; q < i; ++q) {
+            t -= L[i][q] * d[q];
+        }
+        d[i] = t / L[i][i];
+    }
+    for (int i = used - 1; i >= 0; --i) {
+        double t = d[i];
+        for (int q = i + 1; q < used; ++q) {
+            t -= L[q][i] * d[q];
+        }
+        d[i] = t / L[i][i];
+    }
+
+    return used;
+}
+
+// s-шаговый метод минимальных невязок: за один проход строится базис
+// V[m] = (A/theta)^m r, все скалярные произведения собираются одной редукцией,
+// затем x и r обновляются по решению s x s системы нормальных уравнений.
+// V[0] используется как вектор невязки r = b - Ax. ring -- кольцевой буфер
+// потока k из арены, sstep_ring_length(nx, s) значений.
+template <class index_t>
+int ca_minimal_residual_msr_matrix(int nx, int ny, double* A, index_t* I, double* b, double* x,
+    double** V, double* ring, int s, double eps, int maxit, int p, int k) {
+    const int n = (nx + 1) * (ny + 1);
+    const int nsums = 1 + s + s * (s + 1) / 2;
+    double local[1 + SSTEP_MAX + SSTEP_MAX * (SSTEP_MAX + 1) / 2];
+    double sums[1 + SSTEP_MAX + SSTEP_MAX * (SSTEP_MAX + 1) / 2];
+    double G[SSTEP_MAX][SSTEP_MAX];
+    double g[SSTEP_MAX];
+    double d[SSTEP_MAX];
+    int i, i1, i2, its;
+
+    thread_rows(n, p, k, i1, i2);
+
+    // Оценка сверху спектра A по Гершгорину для масштабирования базиса
+    double theta = 0;
+    for (i = i1; i < i2; ++i) {
+        double row = fabs(A[i]);
+        for (index_t q = I[i]; q < I[i + 1]; ++q) {
+            row += fabs(A[q]);
+        }
+        theta = std::max(theta, row);
+    }
+    reduce_sum(p, &theta, 1, &max);
+
+    const double rhs_norm_squared = scalar_product(n, b, b, p, k);
+    const double convergence_threshold = rhs_norm_squared * eps * eps;
+
+    double* r = V[0];
+    matrix_mult_vector_msr(n, A, I, x, r, p, k);
+    for (i = i1; i < i2; ++i) {
+        r[i] = b[i] - r[i];
+    }
+    reduce_sum<int>(p);
+
+    for (its = 0; its < maxit; its += s) {
+        matrix_powers_msr(nx, ny, A, I, V, s, 1.0 / theta, ring, p, k);
+
+        // local[0] = (r, r), local[1 + a] = (r, V[a+1]), далее верхний треугольник Грама
+        {
+            PROFILE_SCOPE(PHASE_DOT);
+            for (int q = 0; q < nsums; ++q) {
+                local[q] = 0;
+            }
+            for (i = i1; i < i2; ++i) {
+                int q = 1 + s;
+                local[0] += r[i] * r[i];
+                for (int a = 0; a < s; ++a) {
+                    const double va = V[a + 1][i];
+                    local[1 + a] += r[i] * va;
+                    for (int c = a; c < s; ++c) {
+                        local[q++] += va * V[c + 1][i];
+                    }
+                }
+            }
+            reduce_sum_det_array(p, k, local, sums, nsums);
+        }
+
+        if (sums[0] < convergence_threshold) {
+            break;
+        }
+
+        int q = 1 + s;
+        for (int a = 0; a < s; ++a) {
+            g[a] = sums[1 + a];
+            for (int c = a; c < s; ++c) {
+                G[a][c] = G[c][a] = sums[q++];
+            }
+        }
+
+        const int used = cholesky_solve(G, g, d, s);
+        if (used == 0) {
+            break;
+        }
+
+        for (i = i1; i < i2; ++i) {
+            double dx = 0, dr = 0;
+            for (int a = 0; a < used; ++a) {
+                dx += d[a] * V[a][i];
+                dr += d[a] * V[a + 1][i];
+            }
+            x[i] += dx / theta;
+            r[i] -= dr;
+        }
+        reduce_sum<int>(p);
+    }
+
+    if (its >= maxit) {
+        return -1;
+    }
+
+    return its;
+}
+
+// Расширенная плитка потока не шире строки сетки; длина кратна строке кэша,
+// чтобы буферы соседних потоков в арене не делили строки
+size_t sstep_ring_length(int nx, int s) {
+    return ((size_t)s * 3 * (nx + 1) + 7) & ~(size_t)7;
+}
+
+#define INSTANTIATE_SSTEP(index_t) \
+    template void matrix_powers_msr(int, int, double*, index_t*, double**, int, double, double*, int, int); \
+    template int ca_minimal_residual_msr_matrix(int, int, double*, index_t*, double*, double*, \
+        double**, double*, int, double, int, int, int);
+
+INSTANTIATE_SSTEP(int)
+INSTANTIATE_SSTEP(long long)
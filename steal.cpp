@@ -0,0 +1,306 @@
+#include "all_includes.h"
+#include "steal.h"
+#include <new>
+
+static StealQueue* queues = nullptr;
+static int* chunk_offset[3] = {nullptr, nullptr, nullptr};
+static double* partials = nullptr;
+static int steal_p = 0;
+static int steal_nx = -1;
+static int steal_ny = -1;
+
+static unsigned long long pack(int lo, int hi) {
+    return (unsigned long long)(unsigned)lo | ((unsigned long long)(unsigned)hi << 32);
+}
+
+static void reset_queue(StealQueue* q, int lo, int hi) {
+    q->range.store(pack(lo, hi), std::memory_order_relaxed);
+}
+
+// Владелец берёт кусок с начала
+static bool pop_front(StealQueue* q, int& chunk) {
+    unsigned long long v = q->range.load(std::memory_order_acquire);
+    for (;;) {
+        const int lo = (int)(v & 0xffffffffULL), hi = (int)(v >> 32);
+        if (lo >= hi) {
+            return false;
+        }
+        if (q->range.compare_exchange_weak(v, pack(lo + 1, hi), std::memory_order_acq_rel)) {
+            chunk = lo;
+            return true;
+        }
+    }
+}
+
+// Чужой поток -- с конца, чтобы не мешать владельцу идти по порядку узлов
+static bool pop_back(StealQueue* q, int& chunk) {
+    unsigned long long v = q->range.load(std::memory_order_acquire);
+    for (;;) {
+        const int lo = (int)(v & 0xffffffffULL), hi = (int)(v >> 32);
+        if (lo >= hi) {
+            return false;
+        }
+        if (q->range.compare_exchange_weak(v, pack(lo, hi - 1), std::memory_order_acq_rel)) {
+            chunk = hi - 1;
+            return true;
+        }
+    }
+}
+
+static bool take(StealQueue* q, int p, int k, int& chunk) {
+    if (pop_front(&q[k], chunk)) {
+        return true;
+    }
+    for (int v = 1; v < p; ++v) {
+        if (pop_back(&q[(k + v) % p], chunk)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Куски режут диапазоны weighted_rows, так что без перехвата поток
+// обрабатывает ровно свой диапазон, как раньше
+int init_steal(const Tiling* tiling) {
+    free_steal();
+    const int p = tiling->p;
+    const int n = (tiling->nx + 1) * (tiling->ny + 1);
+    try {
+        queues = new StealQueue[p];
+        partials = new double[(size_t)p * STEAL_CHUNKS];
+        for (int w = 0; w < 3; ++w) {
+            chunk_offset[w] = new int[(size_t)p * STEAL_CHUNKS + 1];
+        }
+    } catch (std::bad_alloc&) {
+        free_steal();
+        return -1;
+    }
+
+    const node_work kinds[3] = {node_work::assembly, node_work::triangles, node_work::nodes};
+    for (int w = 0; w < 3; ++w) {
+        for (int k = 0; k < p; ++k) {
+            int i1, i2;
+            weighted_rows(kinds[w], n, p, k, i1, i2);
+            for (int m = 0; m < STEAL_CHUNKS; ++m) {
+                chunk_offset[w][k * STEAL_CHUNKS + m] = i1 + (int)((long long)(i2 - i1) * m / STEAL_CHUNKS);
+            }
+        }
+        chunk_offset[w][p * STEAL_CHUNKS] = n;
+    }
+    for (int k = 0; k < p; ++k) {
+        reset_queue(&queues[k], 0, 0);
+    }
+
+    steal_p = p;
+    steal_nx = tiling->nx;
+    steal_ny = tiling->ny;
+    return 0;
+}
+
+void free_steal() {
+    delete[] queues;
+    delete[] partials;
+    queues = nullptr;
+    partials = nullptr;
+    for (int w = 0; w < 3; ++w) {
+        delete[] chunk_offset[w];
+        chunk_offset[w] = nullptr;
+    }
+    steal_p = 0;
+    steal_nx = steal_ny = -1;
+}
+
+// Каждый поток заполняет свою очередь; барьер гарантирует, что никто не
+// начнёт перехват до того, как все очереди готовы. Предыдущий проход
+// обязан закончиться барьером (reduce_sum, steal_sum), иначе очередь
+// могут сбросить, пока из неё ещё берут.
+void steal_begin(StealLoop* loop, node_work work, int n, int p, int k) {
+    loop->n = n;
+    loop->p = p;
+    loop->k = k;
+    loop->done = false;
+    loop->local = 0;
+    loop->chunk = nullptr;
+
+    if (queues == nullptr || p != steal_p || n != (steal_nx + 1) * (steal_ny + 1)) {
+        return;
+    }
+    loop->chunk = chunk_offset[work == node_work::assembly ? 0 : work == node_work::triangles ? 1 : 2];
+    reset_queue(&queues[k], k * STEAL_CHUNKS, (k + 1) * STEAL_CHUNKS);
+    reduce_sum<int>(p);
+}
+
+bool steal_next(StealLoop* loop, int& i1, int& i2, int& chunk) {
+    if (loop->done) {
+        return false;
+    }
+    if (loop->chunk == nullptr) {
+        thread_rows(loop->n, loop->p, loop->k, i1, i2);
+        chunk = loop->k;
+        loop->done = true;
+        return true;
+    }
+    if (!take(queues, loop->p, loop->k, chunk)) {
+        loop->done = true;
+        return false;
+    }
+    i1 = loop->chunk[chunk];
+    i2 = loop->chunk[chunk + 1];
+    return true;
+}
+
+void steal_partial(StealLoop* loop, int chunk, double s) {
+    if (loop->chunk == nullptr) {
+        loop->local += s;
+    } else {
+        partials[chunk] = s;
+    }
+}
+
+// Суммы кусков складываются в порядке узлов, поэтому результат не зависит
+// от того, какой поток какой кусок обработал
+double steal_sum(StealLoop* loop) {
+    if (loop->chunk == nullptr) {
+        return reduce_sum_det(loop->p, loop->k, loop->local);
+    }
+    reduce_sum<int>(loop->p);
+    double s = 0;
+    for (int c = 0; c < loop->p * STEAL_CHUNKS; ++c) {
+        s += partials[c];
+    }
+    return s;
+}
+
+struct StealWorker {
+    StealPool* pool;
+    int k;
+};
+
+static void pool_work(StealPool* pool, int k) {
+    int chunk;
+    while (take(pool->queues, pool->size, k, chunk)) {
+        if (pool->bounds[chunk] < pool->bounds[chunk + 1]) {
+            pool->fn(pool->ctx, pool->bounds[chunk], pool->bounds[chunk + 1]);
+        }
+    }
+}
+
+static void* pool_thread(void* ptr) {
+    StealWorker* worker = (StealWorker*)ptr;
+    StealPool* pool = worker->pool;
+    int seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->generation == seen && !pool->stop) {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+
+        pthread_mutex_unlock(&pool->mutex);
+        pool_work(pool, worker->k);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (++pool->done == pool->size - 1) {
+            pthread_cond_signal(&pool->finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return nullptr;
+}
+
+int steal_pool_init(StealPool* pool, int size) {
+    pool->size = std::max(size, 1);
+    pool->threads = nullptr;
+    pool->workers = nullptr;
+    pool->queues = nullptr;
+    pool->bounds = nullptr;
+    pool->fn = nullptr;
+    pool->ctx = nullptr;
+    pool->generation = 0;
+    pool->done = 0;
+    pool->stop = false;
+    pthread_mutex_init(&pool->mutex, nullptr);
+    pthread_cond_init(&pool->start, nullptr);
+    pthread_cond_init(&pool->finished, nullptr);
+
+    try {
+        pool->threads = new pthread_t[pool->size];
+        pool->queues = new StealQueue[pool->size];
+        pool->bounds = new int[(size_t)pool->size * STEAL_CHUNKS + 1];
+        pool->workers = new StealWorker[pool->size];
+    } catch (std::bad_alloc&) {
+        pool->size = 1;
+        return -1;
+    }
+
+    for (int k = 1; k < pool->size; ++k) {
+        pool->workers[k].pool = pool;
+        pool->workers[k].k = k;
+        if (pthread_create(&pool->threads[k], nullptr, &pool_thread, &pool->workers[k]) != 0) {
+            pool->size = k;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Очереди заполняются до пробуждения рабочих, пока они ждут на start.
+// STEAL_CHUNKS кусков на поток -- цель, а не минимум: короткий диапазон
+// режется на count кусков по одному элементу, и перехват остаётся включён
+void steal_pool_for(StealPool* pool, int count, void (*fn)(void*, int, int), void* ctx) {
+    if (pool->size <= 1 || count < 2) {
+        if (count > 0) {
+            fn(ctx, 0, count);
+        }
+        return;
+    }
+
+    const int chunks = std::min(count, pool->size * STEAL_CHUNKS);
+    for (int c = 0; c <= chunks; ++c) {
+        pool->bounds[c] = (int)((long long)count * c / chunks);
+    }
+    for (int k = 0; k < pool->size; ++k) {
+        reset_queue(&pool->queues[k], (int)((long long)chunks * k / pool->size),
+                    (int)((long long)chunks * (k + 1) / pool->size));
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pool_work(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->done < pool->size - 1) {
+        pthread_cond_wait(&pool->finished, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void steal_pool_free(StealPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int k = 1; k < pool->size; ++k) {
+        pthread_join(pool->threads[k], nullptr);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finished);
+    delete[] pool->threads;
+    delete[] pool->queues;
+    delete[] pool->bounds;
+    delete[] pool->workers;
+    pool->workers = nullptr;
+}
@@ -0,0 +1,65 @@
+#ifndef STEAL_H
+#define STEAL_H
+
+#include <atomic>
+#include <pthread.h>
+#include "tiling.h"
+
+// Перехват работы для проходов вне метода (fill_B, r1-r4, выборки Renderer).
+// Диапазон узлов каждого потока (разбиение по стоимости из tiling) режется на
+// STEAL_CHUNKS кусков; поток берёт свои куски с начала очереди, а закончив,
+// забирает чужие с конца. Очередь -- пара (lo, hi) в одном 64-битном слове,
+// изменяемая CAS, блокировок нет.
+#define STEAL_CHUNKS 16
+
+// Слово очереди занимает свою строку кэша; выравнивание задаётся
+// дополнением, чтобы массив можно было выделять обычным new[]
+struct StealQueue {
+    std::atomic<unsigned long long> range;
+    char pad[64 - sizeof(std::atomic<unsigned long long>)];
+};
+
+// Состояние одного прохода в потоке k. Без подходящего разбиения сетки
+// (например, в распределённом режиме) поток проходит свой thread_rows целиком.
+struct StealLoop {
+    int n;
+    int p;
+    int k;
+    const int* chunk;   // Границы кусков, nullptr -- статический диапазон
+    bool done;
+    double local;       // Сумма потока в статическом режиме
+};
+
+int init_steal(const Tiling* tiling);
+void free_steal();
+
+void steal_begin(StealLoop* loop, node_work work, int n, int p, int k);
+bool steal_next(StealLoop* loop, int& i1, int& i2, int& chunk);
+void steal_partial(StealLoop* loop, int chunk, double s);
+double steal_sum(StealLoop* loop);
+
+struct StealWorker;
+
+// Пул потоков для кода вне решателя: fn(ctx, begin, end) вызывается для
+// кусков [0, count); вызывающий поток работает наравне с остальными
+struct StealPool {
+    int size;
+    pthread_t* threads;
+    StealWorker* workers;
+    StealQueue* queues;
+    int* bounds;        // size * STEAL_CHUNKS + 1 границ текущей задачи
+    void (*fn)(void*, int, int);
+    void* ctx;
+    int generation;
+    int done;
+    bool stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finished;
+};
+
+int steal_pool_init(StealPool* pool, int size);
+void steal_pool_for(StealPool* pool, int count, void (*fn)(void*, int, int), void* ctx);
+void steal_pool_free(StealPool* pool);
+
+#endif // STEAL_H
@@ -0,0 +1,356 @@
+#include "all_includes.h"
+#include "sweep.h"
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <new>
+
+struct SweepWorker {
+    SweepPool* pool;
+    int k;
+};
+
+static void* sweep_worker(void* ptr) {
+    SweepWorker* worker = (SweepWorker*)ptr;
+    SweepPool* pool = worker->pool;
+    int seen = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (pool->generation == seen && !pool->stop) {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        if (worker->k >= pool->active) {
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool->mutex);
+        ::solution(&pool->args[worker->k]);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (++pool->done == pool->active - 1) {
+            pthread_cond_signal(&pool->finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return nullptr;
+}
+
+int sweep_pool_init(SweepPool* pool, int size) {
+    pool->size = size;
+    pool->generation = 0;
+    pool->active = 0;
+    pool->done = 0;
+    pool->stop = false;
+    pool->threads = nullptr;
+    pool->workers = nullptr;
+    pool->args = nullptr;
+    pthread_mutex_init(&pool->mutex, nullptr);
+    pthread_cond_init(&pool->start, nullptr);
+    pthread_cond_init(&pool->finished, nullptr);
+
+    try {
+        pool->threads = new pthread_t[size];
+        pool->args = new Args[size];
+        pool->workers = new SweepWorker[size];
+    } catch (std::bad_alloc&) {
+        // Ни один поток не создан: sweep_pool_free ничего не присоединяет
+        delete[] pool->threads;
+        delete[] pool->args;
+        pool->threads = nullptr;
+        pool->args = nullptr;
+        pool->size = 1;
+        return -1;
+    }
+
+    for (int k = 1; k < size; ++k) {
+        pool->workers[k].pool = pool;
+        pool->workers[k].k = k;
+        if (pthread_create(&pool->threads[k], nullptr, &sweep_worker, &pool->workers[k]) != 0) {
+            pool->size = k;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// args[0..p-1] должны быть заполнены; поток 0 -- вызывающий
+void sweep_pool_run(SweepPool* pool, int p) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->active = p;
+    pool->done = 0;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    ::solution(&pool->args[0]);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->done < p - 1) {
+        pthread_cond_wait(&pool->finished, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void sweep_pool_free(SweepPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int k = 1; k < pool->size; ++k) {
+        pthread_join(pool->threads[k], nullptr);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finished);
+    delete[] pool->threads;
+    delete[] pool->args;
+    delete[] pool->workers;
+    pool->workers = nullptr;
+}
+
+// Пустые строки и строки, начинающиеся с '#', пропускаются.
+// Возвращает номер ошибочной строки или -1, если файл не открывается.
+int read_sweep_jobs(const char* path, SweepJob** jobs, int* count) {
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    std::vector<SweepJob> list;
+    char line[1024];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        line_no++;
+        const char* s = line + strspn(line, " \t");
+        if (*s == '#' || *s == '\n' || *s == '\0') {
+            continue;
+        }
+
+        SweepJob job;
+        job.sstep = 0;
+        int fields = sscanf(s, "%lf %lf %lf %lf %d %d %d %lf %d %d %d",
+            &job.a, &job.b, &job.c, &job.d, &job.nx, &job.ny, &job.k,
+            &job.eps, &job.maxit, &job.p, &job.sstep);
+        if (fields < 10 || job.nx < 1 || job.ny < 1 || job.k < 0 || job.k > 7
+            || job.p < 1 || job.maxit < 1 || job.sstep < 0 || job.sstep > SSTEP_MAX) {
+            fclose(fp);
+            return line_no;
+        }
+        list.push_back(job);
+    }
+    fclose(fp);
+
+    *count = (int)list.size();
+    *jobs = new SweepJob[list.size() + 1];
+    std::copy(list.begin(), list.end(), *jobs);
+    return 0;
+}
+
+// В JSON нет nan и inf: невычисленная невязка расходящейся задачи -- null
+static void print_json_number(FILE* out, const char* name, double value) {
+    if (std::isfinite(value)) {
+        fprintf(out, ", \"%s\": %e", name, value);
+    } else {
+        fprintf(out, ", \"%s\": null", name);
+    }
+}
+
+static void print_result(FILE* out, sweep_format format, const SweepJob& job, const Args& res, double wall) {
+    if (format == sweep_format::json) {
+        fprintf(out,
+            "{\"a\": %g, \"b\": %g, \"c\": %g, \"d\": %g, \"nx\": %d, \"ny\": %d, \"k\": %d, "
+            "\"eps\": %e, \"maxit\": %d, \"p\": %d, \"sstep\": %d, \"its\": %d",
+            job.a, job.b, job.c, job.d, job.nx, job.ny, job.k, job.eps, job.maxit, job.p, job.sstep, res.its);
+        print_json_number(out, "r1", res.res_1);
+        print_json_number(out, "r2", res.res_2);
+        print_json_number(out, "r3", res.res_3);
+        print_json_number(out, "r4", res.res_4);
+        fprintf(out, ", \"t1\": %.6f, \"t2\": %.6f, \"wall\": %.6f}\n", res.t1, res.t2, wall);
+    } else {
+        fprintf(out, "%g,%g,%g,%g,%d,%d,%d,%e,%d,%d,%d,%d,%e,%e,%e,%e,%.6f,%.6f,%.6f\n",
+            job.a, job.b, job.c, job.d, job.nx, job.ny, job.k, job.eps, job.maxit, job.p, job.sstep,
+            res.its, res.res_1, res.res_2, res.res_3, res.res_4, res.t1, res.t2, wall);
+    }
+}
+
+// Серия задач в одном процессе: потоки создаются один раз на максимальное p,
+// арена растёт только при росте сетки, I не пересобирается, пока сетка, p и
+// отображение арены не меняются
+int run_sweep(const SweepJob* jobs, int count, FILE* out, sweep_format format) {
+    int max_p = 1;
+    for (int q = 0; q < count; ++q) {
+        max_p = std::max(max_p, jobs[q].p);
+    }
+
+    if (init_reduce_sum(max_p)) {
+        return 2;
+    }
+
+    SweepPool pool;
+    if (sweep_pool_init(&pool, max_p)) {
+        sweep_pool_free(&pool);
+        return 2;
+    }
+
+    if (format == sweep_format::csv) {
+        fprintf(out, "a,b,c,d,nx,ny,k,eps,maxit,p,sstep,its,r1,r2,r3,r4,t1,t2,wall\n");
+    }
+
+    Arena arena;
+    int status = 0;
+    int last_nx = -1, last_ny = -1, last_p = -1, last_maps = -1;
+
+    for (int q = 0; q < count && status == 0; ++q) {
+        const SweepJob& job = jobs[q];
+        const int nx = job.nx, ny = job.ny, p = job.p;
+        const size_t n = (size_t)(nx + 1) * (ny + 1);
+        double t = wall_time();
+
+        Functions func;
+        func.select_f(job.k);
+
+        if (nx != last_nx || ny != last_ny || p != last_p) {
+            if (init_tiling(nx, ny, p)) {
+                status = 2;
+                break;
+            }
+        }
+
+        const bool wide = msr_needs_64bit(nx, ny);
+        const size_t ring_length = job.sstep > 0 ? (size_t)p * sstep_ring_length(nx, job.sstep) : 0;
+        size_t basis_size = job.sstep > 0 ? arena_region_size((job.sstep + 1) * n * sizeof(double))
+                                          + arena_region_size(ring_length * sizeof(double)) : 0;
+        int* I = nullptr;
+        long long* I64 = nullptr;
+        double* A = nullptr;
+        double* vectors[5];
+        if (arena_reserve(&arena, solver_arena_size(nx, ny, 5) + basis_size)
+            || (wide ? allocate_solver_buffers(&arena, nx, ny, 5, &A, &I64, vectors)
+                     : allocate_solver_buffers(&arena, nx, ny, 5, &A, &I, vectors))) {
+            status = 2;
+            break;
+        }
+        double* V = job.sstep > 0 ? (double*)arena_alloc(&arena, (job.sstep + 1) * n * sizeof(double)) : nullptr;
+        double* ring = job.sstep > 0 ? (double*)arena_alloc(&arena, ring_length * sizeof(double)) : nullptr;
+
+        // Структура I зависит только от сетки и разбиения на плитки
+        if (nx != last_nx || ny != last_ny || p != last_p || arena.maps != last_maps) {
+            if (wide) {
+                fill_I(nx, ny, I64);
+            } else {
+                fill_I(nx, ny, I);
+            }
+            last_nx = nx;
+            last_ny = ny;
+            last_p = p;
+            last_maps = arena.maps;
+        }
+
+        memset(vectors[1], 0, n * sizeof(double));
+
+        for (int k = 0; k < p; ++k) {
+            Args& args = pool.args[k];
+            args = Args();
+            args.a = job.a;
+            args.b = job.b;
+            args.c = job.c;
+            args.d = job.d;
+            args.eps = job.eps;
+            args.I = I;
+            args.I64 = I64;
+            args.A = A;
+            args.B = vectors[0];
+            args.x = vectors[1];
+            args.r = vectors[2];
+            args.u = vectors[3];
+            args.v = vectors[4];
+            args.nx = nx;
+            args.ny = ny;
+            args.maxit = job.maxit;
+            args.p = p;
+            args.k = k;
+            args.f = func.f;
+            args.sstep = job.sstep;
+            args.V = V;
+            args.ring = ring;
+        }
+
+        sweep_pool_run(&pool, p);
+
+        print_result(out, format, job, pool.args[0], wall_time() - t);
+        fflush(out);
+    }
+
+    sweep_pool_free(&pool);
+    free_results();
+    free_tiling();
+    arena_release(&arena);
+    return status;
+}
+
+int sweep_main(int argc, char* argv[]) {
+    const char* list_path = argv[2];
+    const char* out_path = nullptr;
+    sweep_format format = sweep_format::csv;
+
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--sweep-output") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--sweep-format") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "csv") == 0) {
+                format = sweep_format::csv;
+            } else if (strcmp(argv[i], "json") == 0) {
+                format = sweep_format::json;
+            } else {
+                fprintf(stderr, "Error: Unknown sweep format %s.\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown sweep option %s.\n", argv[i]);
+            return 1;
+        }
+    }
+
+    SweepJob* jobs = nullptr;
+    int count = 0;
+    int res = read_sweep_jobs(list_path, &jobs, &count);
+    if (res < 0) {
+        fprintf(stderr, "Error: Cannot open sweep list %s.\n", list_path);
+        return 1;
+    }
+    if (res > 0) {
+        fprintf(stderr, "Error: Invalid parameter set at %s:%d.\n", list_path, res);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (out_path != nullptr) {
+        out = fopen(out_path, "w");
+        if (out == nullptr) {
+            fprintf(stderr, "Error: Cannot open %s for writing.\n", out_path);
+            delete[] jobs;
+            return 1;
+        }
+    }
+
+    int status = run_sweep(jobs, count, out, format);
+    if (status != 0) {
+        fprintf(stderr, "Error: Failed to allocate sweep buffers.\n");
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    delete[] jobs;
+    return status;
+}
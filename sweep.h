@@ -0,0 +1,54 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <pthread.h>
+#include "common_types.h"
+
+// Одна строка списка параметров: те же позиционные аргументы, что у a.out,
+// и необязательная длина блока s-шагового метода
+struct SweepJob {
+    double a;
+    double b;
+    double c;
+    double d;
+    int nx;
+    int ny;
+    int k;
+    double eps;
+    int maxit;
+    int p;
+    int sstep;
+};
+
+enum class sweep_format {
+    csv,
+    json
+};
+
+// Потоки, живущие между задачами серии: рабочий k исполняет solution(&args[k]),
+// если k меньше числа потоков текущей задачи, поток 0 -- вызывающий
+struct SweepWorker;
+
+struct SweepPool {
+    int size;
+    pthread_t* threads;
+    SweepWorker* workers;
+    Args* args;
+    int generation;
+    int active;
+    int done;
+    bool stop;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finished;
+};
+
+int sweep_pool_init(SweepPool* pool, int size);
+void sweep_pool_run(SweepPool* pool, int p);
+void sweep_pool_free(SweepPool* pool);
+
+int read_sweep_jobs(const char* path, SweepJob** jobs, int* count);
+int run_sweep(const SweepJob* jobs, int count, FILE* out, sweep_format format);
+int sweep_main(int argc, char* argv[]);
+
+#endif // SWEEP_H
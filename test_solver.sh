@@ -21,6 +21,7 @@ run_test() {
     local eps=$8
     local maxit=$9
     local threads=${10}
+    local extra="${@:11}"
     
     # Рассчитываем порог в зависимости от заданной точности
     # Если eps меньше 1e-8, используем порог 1e-5, иначе умножаем eps на 1000
@@ -30,11 +31,11 @@ run_test() {
         THRESHOLD=$(echo "$eps * 1000" | awk '{printf "%.2e", $1 * $3}')
     fi
     
-    echo -e "${YELLOW}Тест: a=$a b=$b c=$c d=$d nx=$nx ny=$ny func=$func eps=$eps maxit=$maxit threads=$threads${NC}"
+    echo -e "${YELLOW}Тест: a=$a b=$b c=$c d=$d nx=$nx ny=$ny func=$func eps=$eps maxit=$maxit threads=$threads $extra${NC}"
     echo "Порог невязки для этого теста: $THRESHOLD"
     
     # Запуск программы и сохранение вывода
-    output=$(./a.out $a $b $c $d $nx $ny $func $eps $maxit $threads)
+    output=$(./a.out $a $b $c $d $nx $ny $func $eps $maxit $threads $extra)
     
     # Извлечение значений невязок с помощью регулярных выражений
     r1=$(echo "$output" | grep -oP "R1 = \K[0-9e\.\-]+")
@@ -118,6 +119,79 @@ for threads in 1 2 4; do
     echo
 done
 
+# Тесты распределённого режима (несколько процессов на одной машине)
+for transport in shm socket; do
+    for procs in 2 4; do
+        if run_test 0 1 0 1 30 30 3 1e-8 1000 1 --procs $procs --transport $transport; then
+            ((passed++))
+        else
+            ((failed++))
+        fi
+        echo
+    done
+done
+
+# Тест решения вне памяти (арена на файле во временном каталоге)
+if run_test 0 1 0 1 30 30 3 1e-8 1000 2 --ooc "${TMPDIR:-/tmp}"; then
+    ((passed++))
+else
+    ((failed++))
+fi
+echo
+
+# Тест s-шагового метода минимальных невязок
+if run_test 0 1 0 1 30 30 3 1e-8 1000 4 --sstep 4; then
+    ((passed++))
+else
+    ((failed++))
+fi
+echo
+
+# Тест контрольной точки и продолжения с неё
+ckpt_file="${TMPDIR:-/tmp}/test_solver_ckpt.$$"
+if run_test 0 1 0 1 30 30 3 1e-8 3 2 --checkpoint "$ckpt_file" \
+    && run_test 0 1 0 1 30 30 3 1e-8 3 4 --checkpoint "$ckpt_file" --resume; then
+    ((passed++))
+else
+    ((failed++))
+fi
+rm -f "$ckpt_file"
+echo
+
+# Тест записи решения и полей ошибок в двоичный файл
+output_file="${TMPDIR:-/tmp}/test_solver_output.$$"
+if run_test 0 1 0 1 30 30 3 1e-8 1000 2 --output "$output_file" --output-errors && [ -s "$output_file" ]; then
+    ((passed++))
+else
+    ((failed++))
+fi
+rm -f "$output_file"
+echo
+
+# Тест истории сходимости: заголовок и хотя бы одна запись
+history_file="${TMPDIR:-/tmp}/test_solver_history.$$"
+if run_test 0 1 0 1 30 30 3 1e-8 1000 2 --history "$history_file" && [ "$(wc -l < "$history_file")" -gt 1 ]; then
+    ((passed++))
+else
+    ((failed++))
+fi
+rm -f "$history_file"
+echo
+
+# Тест серии задач в одном процессе: по строке результата на каждую задачу
+sweep_list="${TMPDIR:-/tmp}/test_solver_sweep.$$"
+printf '%s\n' "0 1 0 1 20 20 3 1e-8 1000 1" "0 1 0 1 30 30 3 1e-8 1000 4" "0 1 0 1 20 20 3 1e-8 1000 2 4" > "$sweep_list"
+echo -e "${YELLOW}Тест: --sweep $sweep_list${NC}"
+if [ "$(./a.out --sweep "$sweep_list" --sweep-format json | grep -c '"its"')" -eq 3 ]; then
+    echo -e "${GREEN}ТЕСТ ПРОЙДЕН${NC}"
+    ((passed++))
+else
+    echo -e "${RED}ТЕСТ НЕ ПРОЙДЕН${NC}"
+    ((failed++))
+fi
+rm -f "$sweep_list"
+echo
+
 # Тест с прямоугольной областью
 if run_test -1 1 -2 2 20 30 0 1e-8 1000 1; then
     ((passed++))
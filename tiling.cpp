@@ -0,0 +1,274 @@
+#include "all_includes.h"
+#include <new>
+
+static Tiling tiling = {0, 0, 0, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+static const Tiling* active = nullptr;
+
+// Стоимость в условных единицах: вычисление f -- 4, обход узла -- 1.
+// Модель не зависит от функции и от замеров, поэтому разбиение (а с ним и
+// порядок сложения в reduce_sum_det) одинаково от запуска к запуску.
+#define COST_F 4
+#define COST_NODE 1
+
+static long long node_cost(node_work work, int nx, int ny, int i, int j) {
+    if (work == node_work::triangles) {
+        return (i < nx && j < ny) ? 2 * COST_F + COST_NODE : COST_NODE;
+    }
+    const bool edge_i = i == 0 || i == nx;
+    const bool edge_j = j == 0 || j == ny;
+    int evaluations = 19;
+    if (edge_i && edge_j) {
+        // Углы (0,0) и (nx,ny) касаются двух треугольников, (0,ny) и (nx,0) -- одного
+        evaluations = (i == 0) == (j == 0) ? 9 : 6;
+    } else if (edge_i || edge_j) {
+        evaluations = 12;
+    }
+    return evaluations * COST_F + COST_NODE;
+}
+
+// Внутри строки стоимость отличается только в столбцах 0 и nx
+static long long row_cost(node_work work, int nx, int ny, int i1, int i2, int j) {
+    long long s = 0;
+    if (i1 < i2 && i1 == 0) {
+        s += node_cost(work, nx, ny, 0, j);
+        i1 = 1;
+    }
+    if (i1 < i2 && i2 == nx + 1) {
+        s += node_cost(work, nx, ny, nx, j);
+        i2 = nx;
+    }
+    if (i1 < i2) {
+        s += (long long)(i2 - i1) * node_cost(work, nx, ny, i1, j);
+    }
+    return s;
+}
+
+// Границы диапазонов потоков в плиточной нумерации с равной суммарной
+// стоимостью; строка плитки проходится целиком, по узлам -- только та, где
+// лежит граница, так что построение стоит O(число строк плиток + p * ширина)
+static void weighted_partition(node_work work, int* offset) {
+    const int nx = tiling.nx, ny = tiling.ny, p = tiling.p;
+    long long total = 0;
+    for (int t = 0; t < p; ++t) {
+        int i1, i2, j1, j2;
+        get_tile(t, i1, i2, j1, j2);
+        for (int j = j1; j < j2; ++j) {
+            total += row_cost(work, nx, ny, i1, i2, j);
+        }
+    }
+
+    offset[0] = 0;
+    int next = 1;
+    long long prefix = 0;
+    for (int t = 0; t < p && next < p; ++t) {
+        int i1, i2, j1, j2;
+        get_tile(t, i1, i2, j1, j2);
+        int l = tiling.offset[t];
+        for (int j = j1; j < j2 && next < p; ++j) {
+            const long long w = row_cost(work, nx, ny, i1, i2, j);
+            while (next < p && prefix + w >= total * next / p) {
+                const long long target = total * next / p;
+                long long q = prefix;
+                int i = i1;
+                while (i < i2 && q < target) {
+                    q += node_cost(work, nx, ny, i, j);
+                    ++i;
+                }
+                offset[next++] = l + (i - i1);
+            }
+            prefix += w;
+            l += i2 - i1;
+        }
+    }
+    while (next < p) {
+        offset[next++] = tiling.offset[p];
+    }
+    offset[p] = tiling.offset[p];
+}
+
+int init_tiling(int nx, int ny, int p) {
+    free_tiling();
+
+    // Выбираем px x py = p с минимальной границей плитки на узел
+    int best_px = 1;
+    double best_cost = 0;
+    for (int px = 1; px <= p; ++px) {
+        if (p % px != 0) {
+            continue;
+        }
+        int py = p / px;
+        double w = std::max((double)(nx + 1) / px, 1.0);
+        double h = std::max((double)(ny + 1) / py, 1.0);
+        double cost = 1.0 / w + 1.0 / h;
+        if (px == 1 || cost < best_cost) {
+            best_px = px;
+            best_cost = cost;
+        }
+    }
+
+    tiling.nx = nx;
+    tiling.ny = ny;
+    tiling.p = p;
+    tiling.px = best_px;
+    tiling.py = p / best_px;
+
+    try {
+        tiling.xb = new int[tiling.px + 1];
+        tiling.yb = new int[tiling.py + 1];
+        tiling.offset = new int[p + 1];
+        tiling.col_tile = new int[nx + 1];
+        tiling.row_tile = new int[ny + 1];
+        tiling.assembly_offset = new int[p + 1];
+        tiling.triangle_offset = new int[p + 1];
+    } catch (std::bad_alloc&) {
+        free_tiling();
+        return -1;
+    }
+
+    for (int t = 0; t <= tiling.px; ++t) {
+        tiling.xb[t] = (int)((long long)(nx + 1) * t / tiling.px);
+    }
+    for (int t = 0; t <= tiling.py; ++t) {
+        tiling.yb[t] = (int)((long long)(ny + 1) * t / tiling.py);
+    }
+    for (int t = 0; t < tiling.px; ++t) {
+        for (int i = tiling.xb[t]; i < tiling.xb[t + 1]; ++i) {
+            tiling.col_tile[i] = t;
+        }
+    }
+    for (int t = 0; t < tiling.py; ++t) {
+        for (int j = tiling.yb[t]; j < tiling.yb[t + 1]; ++j) {
+            tiling.row_tile[j] = t;
+        }
+    }
+
+    tiling.offset[0] = 0;
+    for (int t = 0; t < p; ++t) {
+        int tx = t % tiling.px;
+        int ty = t / tiling.px;
+        tiling.offset[t + 1] = tiling.offset[t]
+            + (tiling.xb[tx + 1] - tiling.xb[tx]) * (tiling.yb[ty + 1] - tiling.yb[ty]);
+    }
+
+    // Разбиения по стоимости живут, пока не сменятся сетка или p
+    weighted_partition(node_work::assembly, tiling.assembly_offset);
+    weighted_partition(node_work::triangles, tiling.triangle_offset);
+
+    active = &tiling;
+    if (init_steal(active)) {
+        free_tiling();
+        return -1;
+    }
+    return 0;
+}
+
+void free_tiling() {
+    free_steal();
+    active = nullptr;
+    delete[] tiling.xb;
+    delete[] tiling.yb;
+    delete[] tiling.offset;
+    delete[] tiling.col_tile;
+    delete[] tiling.row_tile;
+    delete[] tiling.assembly_offset;
+    delete[] tiling.triangle_offset;
+    tiling.xb = nullptr;
+    tiling.yb = nullptr;
+    tiling.offset = nullptr;
+    tiling.col_tile = nullptr;
+    tiling.row_tile = nullptr;
+    tiling.assembly_offset = nullptr;
+    tiling.triangle_offset = nullptr;
+}
+
+const Tiling* get_tiling() {
+    return active;
+}
+
+// При px = 1 плитки -- полосы целых строк и нумерация совпадает с естественной
+bool tiling_renumbers(int nx, int ny) {
+    return active != nullptr && active->px > 1 && active->nx == nx && active->ny == ny;
+}
+
+int tile_ij2l(int i, int j) {
+    int tx = tiling.col_tile[i];
+    int ty = tiling.row_tile[j];
+    int x0 = tiling.xb[tx];
+    int y0 = tiling.yb[ty];
+    return tiling.offset[tx + ty * tiling.px] + (j - y0) * (tiling.xb[tx + 1] - x0) + (i - x0);
+}
+
+void tile_l2ij(int l, int& i, int& j) {
+    int t = (int)(std::upper_bound(tiling.offset, tiling.offset + tiling.p + 1, l) - tiling.offset) - 1;
+    int tx = t % tiling.px;
+    int ty = t / tiling.px;
+    int w = tiling.xb[tx + 1] - tiling.xb[tx];
+    int local = l - tiling.offset[t];
+    j = tiling.yb[ty] + local / w;
+    i = tiling.xb[tx] + local % w;
+}
+
+void get_tile(int k, int& i1, int& i2, int& j1, int& j2) {
+    int tx = k % tiling.px;
+    int ty = k / tiling.px;
+    i1 = tiling.xb[tx];
+    i2 = tiling.xb[tx + 1];
+    j1 = tiling.yb[ty];
+    j2 = tiling.yb[ty + 1];
+}
+
+// Диапазон узлов потока k, уравновешенный по стоимости прохода work;
+// без подходящего разбиения -- обычный thread_rows
+void weighted_rows(node_work work, int n, int p, int k, int& i1, int& i2) {
+    if (active == nullptr || active->p != p || n != (active->nx + 1) * (active->ny + 1)) {
+        thread_rows(n, p, k, i1, i2);
+        return;
+    }
+    const int* offset = work == node_work::assembly ? active->assembly_offset
+                       : work == node_work::triangles ? active->triangle_offset : active->offset;
+    i1 = offset[k];
+    i2 = offset[k + 1];
+}
+
+// Перестановка вектора из естественного порядка в плиточный (tmp -- рабочий вектор)
+void natural_to_tiled(int nx, int ny, double* x, double* tmp, int p, int k) {
+    if (!tiling_renumbers(nx, ny)) {
+        return;
+    }
+
+    int i1, i2, j1, j2;
+    get_tile(k, i1, i2, j1, j2);
+    int l = tiling.offset[k];
+    for (int j = j1; j < j2; ++j) {
+        for (int i = i1; i < i2; ++i) {
+            tmp[l++] = x[i + j * (nx + 1)];
+        }
+    }
+    reduce_sum<int>(p);
+
+    for (l = tiling.offset[k]; l < tiling.offset[k + 1]; ++l) {
+        x[l] = tmp[l];
+    }
+    reduce_sum<int>(p);
+}
+
+void tiled_to_natural(int nx, int ny, double* x, double* tmp, int p, int k) {
+    if (!tiling_renumbers(nx, ny)) {
+        return;
+    }
+
+    int i1, i2, j1, j2;
+    get_tile(k, i1, i2, j1, j2);
+    int l = tiling.offset[k];
+    for (int j = j1; j < j2; ++j) {
+        for (int i = i1; i < i2; ++i) {
+            tmp[i + j * (nx + 1)] = x[l++];
+        }
+    }
+    reduce_sum<int>(p);
+
+    for (l = tiling.offset[k]; l < tiling.offset[k + 1]; ++l) {
+        x[l] = tmp[l];
+    }
+    reduce_sum<int>(p);
+}
@@ -0,0 +1,46 @@
+#ifndef TILING_H
+#define TILING_H
+
+// Двумерное разбиение сетки (nx+1) x (ny+1) на px x py прямоугольных плиток,
+// по одной плитке на поток. Узлы нумеруются плитка за плиткой, внутри плитки -- по строкам,
+// поэтому диапазон узлов потока непрерывен, а его блок предобусловливателя двумерный.
+
+// Проходы, у которых стоимость узла неравномерна: сборка правой части (F_IJ
+// вычисляет f в 19 точках для внутреннего узла и в 6-12 на границе) и
+// треугольники r1, r2 (последние строка и столбец пропускаются);
+// nodes -- равная стоимость узлов, это просто плитки
+enum class node_work {
+    assembly,
+    triangles,
+    nodes
+};
+
+struct Tiling {
+    int nx;
+    int ny;
+    int p;
+    int px;
+    int py;
+    int* xb;        // Границы плиток по i, px + 1 значений
+    int* yb;        // Границы плиток по j, py + 1 значений
+    int* offset;    // Номер первого узла плитки t = tx + ty*px, p + 1 значений
+    int* col_tile;  // Номер столбца плиток для каждого i
+    int* row_tile;  // Номер строки плиток для каждого j
+    int* assembly_offset;   // Разбиение по стоимости для node_work::assembly, p + 1 значений
+    int* triangle_offset;   // То же для node_work::triangles
+};
+
+int init_tiling(int nx, int ny, int p);
+void free_tiling();
+const Tiling* get_tiling();
+bool tiling_renumbers(int nx, int ny);
+
+int tile_ij2l(int i, int j);
+void tile_l2ij(int l, int& i, int& j);
+void get_tile(int k, int& i1, int& i2, int& j1, int& j2);
+void weighted_rows(node_work work, int n, int p, int k, int& i1, int& i2);
+
+void natural_to_tiled(int nx, int ny, double* x, double* tmp, int p, int k);
+void tiled_to_natural(int nx, int ny, double* x, double* tmp, int p, int k);
+
+#endif // TILING_H
@@ -0,0 +1,113 @@
+#include "trace.h"
+
+#ifdef APPROX_PROFILE
+
+#include <stdio.h>
+#include <time.h>
+#include <new>
+
+struct TraceEvent {
+    double start;
+    double end;
+    int phase;
+};
+
+// Голова кольца меняется только потоком-владельцем; читается после pthread_join
+struct alignas(64) TraceRing {
+    TraceEvent* events;
+    size_t head;
+};
+
+static TraceRing rings[PROFILE_MAX_THREADS];
+static int ring_count = 0;
+static size_t ring_size = 0;
+static double origin = 0;
+static bool enabled = false;
+
+static thread_local TraceRing* ring = nullptr;
+
+int trace_open(int p, size_t ring_events) {
+    trace_close();
+    if (p > PROFILE_MAX_THREADS) {
+        return -1;
+    }
+    try {
+        for (ring_count = 0; ring_count < p; ++ring_count) {
+            rings[ring_count].head = 0;
+            rings[ring_count].events = new TraceEvent[ring_events];
+        }
+    } catch (std::bad_alloc&) {
+        trace_close();
+        return -1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    origin = ts.tv_sec + ts.tv_nsec * 1e-9;
+    ring_size = ring_events;
+    enabled = true;
+    return 0;
+}
+
+void trace_thread(int k) {
+    ring = enabled && k < ring_count ? &rings[k] : nullptr;
+}
+
+bool trace_enabled() {
+    return enabled;
+}
+
+void trace_record(profile_phase phase, double start, double end) {
+    if (ring == nullptr) {
+        return;
+    }
+    TraceEvent& e = ring->events[ring->head % ring_size];
+    e.start = start;
+    e.end = end;
+    e.phase = phase;
+    ring->head++;
+}
+
+// Полные события ("ph":"X") не требуют парных begin/end, поэтому затирание
+// старых записей в кольце не ломает временную шкалу
+int trace_write(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == nullptr) {
+        return -1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"solver\"}}");
+    size_t dropped = 0;
+    for (int k = 0; k < ring_count; ++k) {
+        const TraceRing& rk = rings[k];
+        fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}", k, k);
+
+        size_t first = rk.head > ring_size ? rk.head - ring_size : 0;
+        dropped += first;
+        for (size_t q = first; q < rk.head; ++q) {
+            const TraceEvent& e = rk.events[q % ring_size];
+            fprintf(fp, ",\n{\"name\": \"%s\", \"cat\": \"solver\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, "
+                "\"ts\": %.3f, \"dur\": %.3f}",
+                profile_phase_name((profile_phase)e.phase), k,
+                (e.start - origin) * 1e6, (e.end - e.start) * 1e6);
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    if (dropped > 0) {
+        fprintf(stderr, "Trace: %zu oldest events were overwritten (ring of %zu per thread).\n", dropped, ring_size);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+void trace_close() {
+    for (int k = 0; k < ring_count; ++k) {
+        delete[] rings[k].events;
+        rings[k].events = nullptr;
+    }
+    ring_count = 0;
+    enabled = false;
+}
+
+#endif // APPROX_PROFILE
@@ -0,0 +1,34 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include "profile.h"
+
+// Временная шкала фаз решателя в формате Chrome trace-event (chrome://tracing,
+// ui.perfetto.dev). События пишутся из тех же точек, что и профиль, поэтому
+// трассировка доступна только при сборке с -DAPPROX_PROFILE.
+// У каждого потока своё кольцо: пишет в него только владелец, блокировок нет,
+// при переполнении затираются самые старые события.
+
+#define TRACE_RING_EVENTS (1 << 16)
+
+#ifdef APPROX_PROFILE
+
+int trace_open(int p, size_t ring_events = TRACE_RING_EVENTS);
+void trace_thread(int k);
+void trace_record(profile_phase phase, double start, double end);
+bool trace_enabled();
+int trace_write(const char* path);
+void trace_close();
+
+#else
+
+inline int trace_open(int, size_t = TRACE_RING_EVENTS) { return -1; }
+inline void trace_thread(int) {}
+inline bool trace_enabled() { return false; }
+inline int trace_write(const char*) { return -1; }
+inline void trace_close() {}
+
+#endif // APPROX_PROFILE
+
+#endif // TRACE_H
@@ -18,8 +18,9 @@ MainWindow::MainWindow(double a, double b, double c, double d,
     : a(a), b(b), c(c), d(d), 
       nx(nx), ny(ny), mx(mx), my(my), 
       k(k), eps(eps), max_its(max_its), p(p),
-      zoom_factor(1.0), paint_mode(what_to_paint::function),
-      running(false), terminating(false), threads_initialized(false) {
+      paint_mode(what_to_paint::function),
+      running(false), terminating(false), threads_initialized(false),
+      dataVersion(0) {
           
     setWindowTitle("2D Function Approximation");
     setMinimumSize(100, 100);
@@ -33,6 +34,9 @@ MainWindow::MainWindow(double a, double b, double c, double d,
     renderer->setRenderMode(paint_mode);
     renderer->setVisualizationDetail(mx, my);
     
+    // Сдвиг и масштаб мышью меняют строку масштаба на панели
+    connect(renderer, &Renderer::viewChanged, this, &MainWindow::updateInfoPanel);
+    
     // Создание и настройка информационной панели
     infoLabel = new QLabel(this);
     infoLabel->setStyleSheet(
@@ -51,8 +55,11 @@ MainWindow::MainWindow(double a, double b, double c, double d,
     infoLabel->setMaximumHeight(24);
     infoLabel->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
     
+    historyPlot = new HistoryPlot(this);
+    
     QVBoxLayout *layout = new QVBoxLayout();
     layout->addWidget(renderer);
+    layout->addWidget(historyPlot);
     layout->addWidget(infoLabel);
     layout->setContentsMargins(5, 5, 5, 5);
     layout->setSpacing(5);
@@ -69,30 +76,30 @@ MainWindow::MainWindow(double a, double b, double c, double d,
     int n = (nx + 1) * (ny + 1);
     
     I = nullptr;
-    if (allocate_msr_matrix(nx, ny, &A, &I)) {
+    I64 = nullptr;
+    if (allocateBuffers()) {
         QMessageBox::critical(this, "Error", "Failed to allocate MSR matrix.");
         close();
         return;
     }
     
-    init_reduce_sum(p);
+    // Без буфера истории решатель работает как прежде, график пуст
+    if (history_init(&history, history_capacity(max_its, SOLVER_MAXSTEPS)) == 0) {
+        historyPlot->setHistory(&history);
+    }
     
-    B = new double[n];
-    x = new double[n];
-    r = new double[n];
-    u = new double[n];
-    v = new double[n];
+    init_reduce_sum(p);
+    init_tiling(nx, ny, p);
     
-    fill_I(nx, ny, I);
+    fillIndices();
     
     memset(x, 0, n * sizeof(double));
     
-    renderer->setData(x, nx + 1, ny + 1);
+    renderer->setData(x, nx + 1, ny + 1, dataVersion);
     
     threads = new pthread_t[p];
     args = new Args[p];
     
-    initializeThreadPool();
     startComputation();
     
     updateInfoPanel();
@@ -106,65 +113,62 @@ MainWindow::~MainWindow() {
     }
     
     cleanupThreadPool();
+    renderer->setData(nullptr, 0, 0, dataVersion);
     
     free_results();
-    delete[] I;
-    delete[] A;
-    delete[] B;
-    delete[] x;
-    delete[] r;
-    delete[] u;
-    delete[] v;
+    free_tiling();
+    arena_release(&arena);
+    history_free(&history);
     delete[] args;
     delete[] threads;
 }
 
-void MainWindow::initializeThreadPool() {
-    if (threads_initialized) {
-        return;
-    }
+// Матрица и векторы берутся из арены окна; при уменьшении сетки
+// отображение переиспользуется, при росте -- пересоздаётся
+int MainWindow::allocateBuffers() {
+    double* vectors[5];
+    const size_t cells = (size_t)nx * ny * sizeof(double);
     
-    for (int i = 1; i < p; ++i) {
-        args[i].a = a;
-        args[i].b = b;
-        args[i].c = c;
-        args[i].d = d;
-        args[i].eps = eps;
-        args[i].I = I;
-        args[i].A = A;
-        args[i].B = B;
-        args[i].x = x;
-        args[i].r = r;
-        args[i].u = u;
-        args[i].v = v;
-        args[i].nx = nx;
-        args[i].ny = ny;
-        args[i].maxit = max_its;
-        args[i].p = p;
-        args[i].k = i;
-        args[i].f = func.f;
-        args[i].completed = false;
-        
-        pthread_create(&threads[i], nullptr, &::solution, &args[i]);
+    // Фоновый поток renderer не должен читать x и cellErrors во время перевыделения
+    renderer->setData(nullptr, 0, 0, dataVersion);
+    
+    I = nullptr;
+    I64 = nullptr;
+    if (arena_reserve(&arena, solver_arena_size(nx, ny, 5) + arena_region_size(cells))) {
+        return 1;
+    }
+    if (msr_needs_64bit(nx, ny) ? allocate_solver_buffers(&arena, nx, ny, 5, &A, &I64, vectors)
+                                : allocate_solver_buffers(&arena, nx, ny, 5, &A, &I, vectors)) {
+        return 1;
     }
     
-    threads_initialized = true;
+    B = vectors[0];
+    x = vectors[1];
+    r = vectors[2];
+    u = vectors[3];
+    v = vectors[4];
+    
+    // Погрешность по ячейкам для режима погрешности, её заполняет r1
+    cellErrors = (double*)arena_alloc(&arena, cells);
+    return cellErrors == nullptr ? 1 : 0;
 }
 
+void MainWindow::fillIndices() {
+    if (I64 != nullptr) {
+        fill_I(nx, ny, I64);
+    } else {
+        fill_I(nx, ny, I);
+    }
+}
+
+// Дожидается потоков расчёта, если они запущены и ещё не присоединены
 void MainWindow::cleanupThreadPool() {
     if (!threads_initialized) {
         return;
     }
     
-    // Make sure we join threads only if they were started
-    if (running && main_thread != 0) {
-        pthread_join(main_thread, nullptr);
-    }
-    
-    for (int i = 1; i < p; ++i) {
-        if (threads[i] != 0) {
-            pthread_join(threads[i], nullptr);
-        }
+    for (int i = 0; i < p; ++i) {
+        pthread_join(threads[i], nullptr);
     }
     
     threads_initialized = false;
@@ -184,6 +188,7 @@ void MainWindow::startComputation() {
         args[i].d = d;
         args[i].eps = eps;
         args[i].I = I;
+        args[i].I64 = I64;
         args[i].A = A;
         args[i].B = B;
         args[i].x = x;
@@ -196,12 +201,43 @@ void MainWindow::startComputation() {
         args[i].p = p;
         args[i].k = i;
         args[i].f = func.f;
+        args[i].history = history.records != nullptr ? &history : nullptr;
+        args[i].cell_errors = cellErrors;
         args[i].completed = false;
     }
     
-    // Start main computation thread
-    main_thread = pthread_self();
-    ::solution(&args[0]);
+    // Историю пишет только поток 0, он стартует ниже
+    history_reset(&history);
+    
+    // Решение x перезаписывается, кадр визуализации нужно построить заново.
+    // Фоновый поток renderer не должен читать x и cellErrors, пока их
+    // переписывает решатель: данные отключаются до конца расчёта, setData
+    // дожидается плитки, которая рисуется сейчас
+    dataVersion++;
+    renderer->setData(nullptr, 0, 0, dataVersion);
+    
+    // Все p потоков расчёта создаются заново для каждого запуска, поток GUI
+    // только ждёт их по таймеру: окно и график сходимости обновляются во
+    // время расчёта. Без хотя бы одного из потоков остальные встали бы на барьере
+    for (int i = 0; i < p; ++i) {
+        if (pthread_create(&threads[i], nullptr, &gui_solution, &args[i]) != 0) {
+            fprintf(stderr, "Error: Failed to start solver thread %d.\n", i);
+            _Exit(1);
+        }
+    }
+    threads_initialized = true;
+}
+
+Renderer *MainWindow::getRenderer() const {
+    return renderer;
+}
+
+bool MainWindow::isRunning() const {
+    return running;
+}
+
+double MainWindow::lastSolveTime() const {
+    return args[0].wall;
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *event) {
@@ -279,16 +315,12 @@ void MainWindow::updateUI() {
     
     // Update the info panel to show current status
     updateInfoPanel();
+    historyPlot->refresh();
     
     // Check if computation has completed
     if (running && args[0].completed) {
-        // Join all threads
-        pthread_join(main_thread, nullptr);
-        
-        for (int i = 1; i < p; ++i) {
-            pthread_join(threads[i], nullptr);
-        }
-        
+        // Поток 0 отмечает завершение после последнего барьера, остальные уже выходят
+        cleanupThreadPool();
         running = false;
         
         int its = args[0].its;
@@ -310,13 +342,16 @@ void MainWindow::updateUI() {
             its, eps, k, 
             nx, ny, p);
         
-        renderer->setData(x, nx + 1, ny + 1);
+        // Поле погрешности готово вместе с r1, его максимум и есть r1
+        renderer->setResidualField(cellErrors, nx + 1, ny + 1, r1, dataVersion);
+        renderer->setData(x, nx + 1, ny + 1, dataVersion);
         updateInfoPanel(); // Update again after completion
+        emit computationFinished();
     }
     
+    // Без новых данных renderer ничего не пересчитывает и не перерисовывает
     if (!running) {
-        renderer->setData(x, nx + 1, ny + 1);
-        renderer->update();
+        renderer->setData(x, nx + 1, ny + 1, dataVersion);
     }
 }
 
@@ -347,15 +382,8 @@ void MainWindow::toggleRenderMode() {
             break;
     }
     
+    // Максимум погрешности пересчитывается в setRenderMode
     renderer->setRenderMode(paint_mode);
-    
-    // Force update if switching to residual mode
-    if (paint_mode == what_to_paint::residual) {
-        // This causes the residual to be recalculated
-        renderer->setData(x, nx + 1, ny + 1);
-    }
-    
-    renderer->update();
     updateInfoPanel();
 }
 
@@ -365,8 +393,7 @@ void MainWindow::zoomIn() {
         return;
     }
     
-    zoom_factor *= 2.0;
-    renderer->setZoom(zoom_factor);
+    renderer->setZoom(renderer->getZoom() * 2.0);
     updateInfoPanel();
 }
 
@@ -376,8 +403,7 @@ void MainWindow::zoomOut() {
         return;
     }
     
-    zoom_factor = 1.0;
-    renderer->setZoom(zoom_factor);
+    renderer->resetView();
     updateInfoPanel();
 }
 
@@ -387,33 +413,19 @@ void MainWindow::increaseGridDimension() {
     
     int n = (nx + 1) * (ny + 1);
     
-    delete[] I;
-    delete[] A;
-    delete[] B;
-    delete[] x;
-    delete[] r;
-    delete[] u;
-    delete[] v;
-    
-    I = nullptr;
-    if (allocate_msr_matrix(nx, ny, &A, &I)) {
+    if (allocateBuffers()) {
         QMessageBox::critical(this, "Error", "Failed to allocate MSR matrix.");
         close();
         return;
     }
     
-    B = new double[n];
-    x = new double[n];
-    r = new double[n];
-    u = new double[n];
-    v = new double[n];
-    
-    fill_I(nx, ny, I);
+    init_tiling(nx, ny, p);
+    fillIndices();
     
     // Initialize solution vector with zeros
     memset(x, 0, n * sizeof(double));
     
-    renderer->setData(x, nx + 1, ny + 1);
+    renderer->setData(x, nx + 1, ny + 1, dataVersion);
     
     // Restart computation
     startComputation();
@@ -431,34 +443,19 @@ void MainWindow::decreaseGridDimension() {
     // Reallocate memory for computation
     int n = (nx + 1) * (ny + 1);
     
-    // Free old memory
-    delete[] I;
-    delete[] A;
-    delete[] B;
-    delete[] x;
-    delete[] r;
-    delete[] u;
-    delete[] v;
-    
-    // Allocate new memory
-    I = nullptr;
-    if (allocate_msr_matrix(nx, ny, &A, &I)) {
+    // Reuse the arena for the smaller grid
+    if (allocateBuffers()) {
         QMessageBox::critical(this, "Error", "Failed to allocate MSR matrix.");
         close();
         return;
     }
     
-    B = new double[n];
-    x = new double[n];
-    r = new double[n];
-    u = new double[n];
-    v = new double[n];
-    
-    fill_I(nx, ny, I);
+    init_tiling(nx, ny, p);
+    fillIndices();
     
     memset(x, 0, n * sizeof(double));
     
-    renderer->setData(x, nx + 1, ny + 1);
+    renderer->setData(x, nx + 1, ny + 1, dataVersion);
     
     startComputation();
 }
@@ -542,7 +539,7 @@ void MainWindow::updateInfoPanel() {
     oss << " | Сетка:" << nx << "×" << ny 
         << " | Виз:" << mx << "×" << my
         << " | Обл:[" << a << "," << b << "]×[" << c << "," << d << "]"
-        << " | М:" << zoom_factor << "×"
+        << " | М:" << renderer->getZoom() << "×"
         << " | ε:" << eps
         << " | П:" << p;
     
@@ -565,8 +562,13 @@ QPointF MainWindow::l2g(double x, double y) {
 }
 
 // Thread function implementation
+// Время по часам пишется после возврата solution(): окно читает его после pthread_join
 void* gui_solution(void* ptr) {
-    return solution(ptr);
+    Args* args = (Args*)ptr;
+    double t = wall_time();
+    void* res = solution(ptr);
+    args->wall = wall_time() - t;
+    return res;
 }
 
 // Новый метод для отображения справки
@@ -576,20 +578,21 @@ void MainWindow::showHelp() {
         "0 - переключение на следующую функцию (циклически 0..7)\n"
         "1 - циклическое переключение режимов отображения (функция → аппроксимация → остаток)\n"
         "2 - увеличение масштаба (приближение)\n"
-        "3 - уменьшение масштаба (отдаление)\n"
+        "3 - исходный масштаб и положение\n"
         "4 - увеличение размерности расчетной сетки (nx, ny) в 2 раза\n"
         "5 - уменьшение размерности расчетной сетки (nx, ny) в 2 раза (не менее 5)\n"
         "6 - увеличение параметра погрешности\n"
         "7 - уменьшение параметра погрешности\n"
         "8 - увеличение детализации визуализации (mx, my) в 2 раза\n"
         "9 - уменьшение детализации визуализации (mx, my) в 2 раза (не менее 5)\n"
-        "H или F1 - показать эту справку\n\n"
+        "H или F1 - показать эту справку\n"
+        "Мышь: перетаскивание - сдвиг, колесо - масштаб вокруг курсора\n\n"
         "Текущие параметры:\n"
         "Функция: " + QString::number(k) + "\n"
         "Расчетная сетка: " + QString::number(nx) + "×" + QString::number(ny) + "\n"
         "Визуализация: " + QString::number(mx) + "×" + QString::number(my) + "\n"
         "Точность ε: " + QString::number(eps) + "\n"
-        "Масштаб: " + QString::number(zoom_factor) + "×";
+        "Масштаб: " + QString::number(renderer->getZoom()) + "×";
     
     QMessageBox::information(this, "Справка по командам", helpText);
 } 
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <pthread.h>
 #include "all_includes.h"
 #include "renderer.hpp"
+#include "history_plot.hpp"
 
 // Enumeration for visualization modes
 enum class what_to_paint {
@@ -27,6 +28,13 @@ public:
                int k, double eps, int max_its, int p);
     ~MainWindow();
 
+    Renderer *getRenderer() const;
+    bool isRunning() const;     // Идёт расчёт: клавиши, кроме справки, не принимаются
+    double lastSolveTime() const; // Последний расчёт по часам, с; верно после computationFinished
+
+signals:
+    void computationFinished(); // Расчёт завершён, данные переданы в renderer
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
@@ -43,10 +51,10 @@ private:
     double eps;             // Accuracy parameter
     int max_its;            // Maximum iterations
     int p;                  // Number of threads
-    double zoom_factor;     // Current zoom factor
     
     // UI elements
     Renderer *renderer;     // Custom rendering widget
+    HistoryPlot *historyPlot; // Convergence plot under the renderer
     QLabel *infoLabel;      // Information panel
     QTimer *timer;          // Timer for UI updates
     
@@ -54,27 +62,33 @@ private:
     what_to_paint paint_mode;
     
     // Multithreading
-    pthread_t *threads;
-    pthread_t main_thread;  // Thread handle for main computation thread
+    pthread_t *threads;     // p потоков расчёта, создаются в startComputation
     Args *args;
     QMutex dataMutex;
     QWaitCondition dataReady;
     bool running;
     bool terminating;
-    bool threads_initialized;  // Flag to track if threads are initialized
+    bool threads_initialized;  // Потоки расчёта запущены и ещё не присоединены
+    unsigned long long dataVersion;  // Номер расчёта, по нему renderer узнаёт о новом x
     
     // Thread pool management
-    void initializeThreadPool();
     void cleanupThreadPool();
     
     // Computational data
     double *A;              // Matrix A
     int *I;                 // Matrix I indices
+    long long *I64;         // Matrix I indices for grids past INT_MAX nonzeros
     double *B;              // Right-hand side vector
     double *x;              // Solution vector
     double *r;              // Residual vector
     double *u, *v;          // Work vectors
+    double *cellErrors;     // Погрешность по ячейкам, nx * ny, от решателя для renderer
     Functions func;         // Function object
+    Arena arena;            // Single mapping for the matrix and vectors
+    History history;        // Convergence history of the current solve
+    
+    int allocateBuffers();
+    void fillIndices();
     
     // Private methods
     void startComputation();